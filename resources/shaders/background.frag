@@ -4,18 +4,54 @@ in INTERFACE {
 	vec2 uv;
 } In ;
 
-uniform float time;
+layout(std140) uniform FrameData {
+	vec2 inverseScreenSize;
+	float time;
+	float scrollTime;
+} frame;
+
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
+#ifdef REVERSE_MODE
+const bool reverseMode = true;
+#else
+const bool reverseMode = false;
+#endif
+
 uniform float secondsPerMeasure;
-uniform vec2 inverseScreenSize;
-uniform bool useDigits = true;
-uniform bool useHLines = true;
-uniform bool useVLines = true;
-uniform float minorsWidth = 1.0;
+#ifdef USE_DIGITS
+const bool useDigits = true;
+#else
+const bool useDigits = false;
+#endif
+#ifdef USE_HLINES
+const bool useHLines = true;
+#else
+const bool useHLines = false;
+#endif
+#ifdef USE_VLINES
+const bool useVLines = true;
+#else
+const bool useVLines = false;
+#endif
 uniform sampler2D screenTexture;
 uniform vec3 textColor = vec3(1.0);
 uniform vec3 linesColor = vec3(1.0);
-uniform bool reverseMode = false;
-uniform bool horizontalMode = false;
+// Vertical range covered by the quad, can extend beyond the screen.
+uniform vec2 uvRange = vec2(0.0, 1.0);
 
 
 vec2 flipUVIfNeeded(vec2 inUV){
@@ -26,12 +62,6 @@ vec2 flipUVIfNeeded(vec2 inUV){
 #define MAJOR_COUNT 75.0
 
 const float octaveLinesPositions[11] = float[](0.0/75.0, 7.0/75.0, 14.0/75.0, 21.0/75.0, 28.0/75.0, 35.0/75.0, 42.0/75.0, 49.0/75.0, 56.0/75.0, 63.0/75.0, 70.0/75.0);
-			
-uniform float mainSpeed;
-uniform float keyboardHeight = 0.25;
-
-uniform int minNoteMajor;
-uniform float notesCount;
 
 out vec4 fragColor;
 
@@ -60,7 +90,7 @@ float printNumber(float num, vec2 position, vec2 uv, vec2 scale){
 	if(num < -0.1){
 		return 0.0f;
 	}
-	if(position.y > 1.0 || position.y < 0.0){
+	if(position.y > uvRange.y || position.y < uvRange.x){
 		return 0.0;
 	}
 	
@@ -98,42 +128,47 @@ float printNumber(float num, vec2 position, vec2 uv, vec2 scale){
 void main(){
 	
 	vec4 bgColor = vec4(0.0);
-	vec2 inUV = In.uv;
+	vec2 inUV = vec2(In.uv.x, mix(uvRange.x, uvRange.y, In.uv.y));
 
-	float xRatio = horizontalMode ? inverseScreenSize.y : inverseScreenSize.x;
-	float yRatio = horizontalMode ? inverseScreenSize.x : inverseScreenSize.y;
+	float xRatio = horizontalMode ? frame.inverseScreenSize.y : frame.inverseScreenSize.x;
+	float yRatio = horizontalMode ? frame.inverseScreenSize.x : frame.inverseScreenSize.y;
 
 	// Octaves lines.
 	if(useVLines){
 		// send 0 to (minNote)/MAJOR_COUNT
 		// send 1 to (maxNote)/MAJOR_COUNT
-		float a = (notesCount) / MAJOR_COUNT;
-		float b = float(minNoteMajor) / MAJOR_COUNT;
+		float a = (scene.notesCount) / MAJOR_COUNT;
+		float b = float(scene.minNoteMajor) / MAJOR_COUNT;
 		float refPos = a * inUV.x + b;
 
 		for(int i = 0; i < 11; i++){
 			float linePos = octaveLinesPositions[i];
-			float lineIntensity = 0.7 * step(abs(refPos - linePos), xRatio / MAJOR_COUNT * notesCount);
+			float lineIntensity = 0.7 * step(abs(refPos - linePos), xRatio / MAJOR_COUNT * scene.notesCount);
 			bgColor = mix(bgColor, vec4(linesColor, 1.0), lineIntensity);
 		}
 	}
 
-	float screenRatio = inverseScreenSize.x/inverseScreenSize.y;
+	float screenRatio = frame.inverseScreenSize.x/frame.inverseScreenSize.y;
 	vec2 scale = 1.5 * vec2(64.0, 50.0 * screenRatio);
 	if(horizontalMode){
 		scale = scale.yx;
 	}
 
 	// Text on the side.
-	int currentMesure = int(floor(time/secondsPerMeasure));
+	// Measures whose line is in the covered range.
+	float speed = 0.5 * scene.mainSpeed * (reverseMode ? -1.0 : 1.0);
+	float lowMesure = (frame.scrollTime + (uvRange.x - scene.keyboardHeight) / speed) / secondsPerMeasure;
+	float highMesure = (frame.scrollTime + (uvRange.y - scene.keyboardHeight) / speed) / secondsPerMeasure;
+	int firstMesure = int(floor(min(lowMesure, highMesure)));
+	int lastMesure = int(ceil(max(lowMesure, highMesure)));
 	// How many mesures do we check.
-	int count = int(ceil(0.75*(2.0/mainSpeed)))+2;
+	int count = min(lastMesure - firstMesure + 1, 512);
 
 	// We check two extra measures to avoid sudden disappearance below the keyboard.
 	for(int i = -2; i < count; i++){
-		// Compute position of the measure currentMesure+-i.
-		int mesure = currentMesure + (reverseMode ? -1 : 1) * i;
-		vec2 position = vec2(0.005, keyboardHeight + (reverseMode ? -1.0 : 1.0) * (secondsPerMeasure * mesure - time)*mainSpeed*0.5);
+		// Compute position of the measure, from the bottom up.
+		int mesure = reverseMode ? (firstMesure + count - 1 - i) : (firstMesure + i);
+		vec2 position = vec2(0.005, scene.keyboardHeight + (reverseMode ? -1.0 : 1.0) * (secondsPerMeasure * mesure - frame.scrollTime)*scene.mainSpeed*0.5);
 
 		// Compute color for the number display, and for the horizontal line.
 		float numberIntensity = useDigits ? printNumber(mesure, position, inUV, scale) : 0.0;
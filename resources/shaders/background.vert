@@ -2,7 +2,21 @@
 
 layout(location = 0) in vec3 v;
 
-uniform bool horizontalMode = false;
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
 
 vec2 flipIfNeeded(vec2 inPos){
 	return horizontalMode ? vec2(inPos.y, -inPos.x) : inPos;
@@ -6,13 +6,22 @@ out INTERFACE {
 	vec2 uv;
 } Out ;
 
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
 uniform bool behindKeyboard;
-uniform float keyboardHeight = 0.25;
 
 void main(){
 	vec2 pos = v;
 	if(!behindKeyboard){
-		pos.y = (1.0-keyboardHeight) * pos.y + keyboardHeight;
+		pos.y = (1.0-scene.keyboardHeight) * pos.y + scene.keyboardHeight;
 	}
 	// We directly output the position.
 	gl_Position = vec4(pos, 0.0, 1.0);
@@ -0,0 +1,56 @@
+#version 330
+
+in INTERFACE {
+	vec2 uv;
+} In ;
+
+uniform sampler2D screenTexture;
+uniform int plane; // 0: luma, 1: blue chroma, 2: red chroma, 3: alpha.
+uniform vec2 subsampling; // Frame pixels covered by a texel of the plane.
+uniform float depthScale; // 1 for 8 bits values, 4 for 10 bits.
+uniform float maxValue; // Largest value of the target format (255 or 65535).
+uniform bool opaque;
+uniform bool unpremultiply;
+
+out vec4 fragColor;
+
+
+vec4 framePixel(ivec2 coords){
+	vec4 color = texelFetch(screenTexture, coords, 0);
+	if(opaque){
+		color.a = 1.0;
+	} else if(unpremultiply && color.a > 0.0){
+		color.rgb = clamp(color.rgb / color.a, 0.0, 1.0);
+	}
+	return color;
+}
+
+void main(){
+	// Video frames are stored top row first, flip vertically while fetching.
+	ivec2 frameSize = textureSize(screenTexture, 0);
+	ivec2 block = ivec2(subsampling);
+	ivec2 base = ivec2(gl_FragCoord.xy) * block;
+	vec4 color = vec4(0.0);
+	for(int y = 0; y < block.y; ++y){
+		for(int x = 0; x < block.x; ++x){
+			color += framePixel(ivec2(base.x + x, frameSize.y - 1 - base.y - y));
+		}
+	}
+	color /= float(block.x * block.y);
+
+	// ITU-R BT.601 with limited range, as the default software conversion.
+	float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+	float value = 0.0;
+	if(plane == 0){
+		value = 16.0 + 219.0 * luma;
+	} else if(plane == 1){
+		value = 128.0 + 224.0 * (color.b - luma) / 1.772;
+	} else if(plane == 2){
+		value = 128.0 + 224.0 * (color.r - luma) / 1.402;
+	} else {
+		// Full range.
+		value = (256.0 - 1.0 / depthScale) * color.a;
+	}
+	// Round to an integer code, normalized for the target format.
+	fragColor = vec4(floor(value * depthScale + 0.5) / maxValue);
+}
@@ -0,0 +1,25 @@
+#version 330
+
+in INTERFACE {
+	vec2 uv;
+} In ;
+
+uniform sampler2D screenTexture;
+uniform bool opaque;
+uniform bool unpremultiply;
+
+out vec4 fragColor;
+
+
+void main(){
+	// Images are stored top row first, flip vertically while fetching.
+	ivec2 frameSize = textureSize(screenTexture, 0);
+	ivec2 coords = ivec2(gl_FragCoord.xy);
+	vec4 color = texelFetch(screenTexture, ivec2(coords.x, frameSize.y - 1 - coords.y), 0);
+	if(opaque){
+		color.a = 1.0;
+	} else if(unpremultiply && color.a > 0.0){
+		color.rgb = clamp(color.rgb / color.a, 0.0, 1.0);
+	}
+	fragColor = color;
+}
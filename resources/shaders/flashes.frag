@@ -9,8 +9,21 @@ in INTERFACE {
 } In;
 
 uniform sampler2D textureFlash;
-uniform float time;
-uniform vec3 baseColor[SETS_COUNT];
+
+layout(std140) uniform FrameData {
+	vec2 inverseScreenSize;
+	float time;
+	float scrollTime;
+} frame;
+
+layout(std140) uniform PaletteData {
+	vec3 notesMajor[SETS_COUNT];
+	vec3 notesMinor[SETS_COUNT];
+	vec3 flashes[SETS_COUNT];
+	vec3 particles[SETS_COUNT];
+	vec3 keysMajor[SETS_COUNT];
+	vec3 keysMinor[SETS_COUNT];
+} palette;
 
 #define numberSprites 8.0
 
@@ -34,7 +47,7 @@ void main(){
 	// If up half, read from texture atlas.
 	if(In.uv.y > 0.0){
 		// Select a sprite, depending on time and flash id.
-		float shift = floor(mod(15.0 * time, numberSprites)) + floor(rand(In.id * vec2(time,1.0)));
+		float shift = floor(mod(15.0 * frame.time, numberSprites)) + floor(rand(In.id * vec2(frame.time,1.0)));
 		vec2 globalUV = vec2(0.5 * mod(shift, 2.0), 0.25 * floor(shift/2.0));
 		
 		// Scale UV to fit in one sprite from atlas.
@@ -47,7 +60,7 @@ void main(){
 	}
 	
 	// Colored sprite.
-	vec4 spriteColor = vec4(baseColor[cid], mask);
+	vec4 spriteColor = vec4(palette.flashes[cid], mask);
 	
 	// Circular halo effect.
 	float haloAlpha = 1.0 - smoothstep(0.07,0.5,length(In.uv));
@@ -3,14 +3,29 @@
 layout(location = 0) in vec2 v;
 layout(location = 1) in int onChan;
 
-uniform float time;
-uniform vec2 inverseScreenSize;
-uniform float userScale = 1.0;
-uniform float keyboardHeight = 0.25;
+layout(std140) uniform FrameData {
+	vec2 inverseScreenSize;
+	float time;
+	float scrollTime;
+} frame;
+
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
 
-uniform int minNote;
-uniform float notesCount;
-uniform bool horizontalMode = false;
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
+
+uniform float userScale = 1.0;
 
 vec2 flipIfNeeded(vec2 inPos){
 	return horizontalMode ? vec2(inPos.y, -inPos.x) : inPos;
@@ -32,12 +47,12 @@ out INTERFACE {
 void main(){
 	
 	// Scale quad, keep the square ratio.
-	float screenRatio = inverseScreenSize.y/inverseScreenSize.x;
+	float screenRatio = frame.inverseScreenSize.y/frame.inverseScreenSize.x;
 	vec2 scalingFactor = vec2(1.0, horizontalMode ? (1.0/screenRatio) : screenRatio);
 
-	vec2 scaledPosition = v * 2.0 * scale * userScale/notesCount * scalingFactor;
+	vec2 scaledPosition = v * 2.0 * scale * userScale/scene.notesCount * scalingFactor;
 	// Shift based on note/flash id.
-	vec2 globalShift = vec2(-1.0 + ((shifts[gl_InstanceID] - shifts[minNote]) * 2.0 + 1.0) / notesCount, 2.0 * keyboardHeight - 1.0);
+	vec2 globalShift = vec2(-1.0 + ((shifts[gl_InstanceID] - shifts[scene.minNote]) * 2.0 + 1.0) / scene.notesCount, 2.0 * scene.keyboardHeight - 1.0);
 	
 	gl_Position = vec4(flipIfNeeded(scaledPosition + globalShift), 0.0 , 1.0) ;
 	
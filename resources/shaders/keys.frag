@@ -7,17 +7,44 @@ in INTERFACE {
 #define SETS_COUNT 8
 #define MAJOR_COUNT 75
 
-uniform vec2 inverseScreenSize;
-uniform float minorsWidth = 1.0;
-uniform vec3 keysColor = vec3(0.0);
-uniform vec3 minorColor[SETS_COUNT];
-uniform vec3 majorColor[SETS_COUNT];
-uniform bool highlightKeys;
-uniform bool horizontalMode = false;
-uniform int actives[128];
+layout(std140) uniform FrameData {
+	vec2 inverseScreenSize;
+	float time;
+	float scrollTime;
+} frame;
+
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
 
-uniform int minNoteMajor;
-uniform float notesCount; // (maxNoteMajor - minNoteMajor + 1)
+layout(std140) uniform PaletteData {
+	vec3 notesMajor[SETS_COUNT];
+	vec3 notesMinor[SETS_COUNT];
+	vec3 flashes[SETS_COUNT];
+	vec3 particles[SETS_COUNT];
+	vec3 keysMajor[SETS_COUNT];
+	vec3 keysMinor[SETS_COUNT];
+} palette;
+
+uniform vec3 keysColor = vec3(0.0);
+#ifdef HIGHLIGHT_KEYS
+const bool highlightKeys = true;
+#else
+const bool highlightKeys = false;
+#endif
+uniform isamplerBuffer actives;
 
 const bool isMinor[MAJOR_COUNT] = bool[](true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, true, true, false,  true, true, false, true, false);
 
@@ -44,37 +71,37 @@ void main(){
 	// Active key: activeColor
 
 	// White keys, and separators.
-	float widthScaling = horizontalMode ? inverseScreenSize.y : inverseScreenSize.x;
-	float intensity = int(abs(fract(In.uv.x * notesCount)) >= 2.0 * notesCount * widthScaling);
+	float widthScaling = horizontalMode ? frame.inverseScreenSize.y : frame.inverseScreenSize.x;
+	float intensity = int(abs(fract(In.uv.x * scene.notesCount)) >= 2.0 * scene.notesCount * widthScaling);
 	
 	// If the current major key is active, the majorColor is specific.
-	int majorId = majorIds[clamp(int(In.uv.x * notesCount) + minNoteMajor, 0, 74)];
-	int cidMajor = actives[majorId];
-	vec3 backColor = (highlightKeys && cidMajor >= 0) ? majorColor[cidMajor] : vec3(1.0);
+	int majorId = majorIds[clamp(int(In.uv.x * scene.notesCount) + scene.minNoteMajor, 0, 74)];
+	int cidMajor = texelFetch(actives, majorId).r;
+	vec3 backColor = (highlightKeys && cidMajor >= 0) ? palette.keysMajor[cidMajor] : vec3(1.0);
 
 	vec3 frontColor = keysColor;
 	// Upper keyboard.
 	if(In.uv.y > 0.4){
-		int minorLocalId = min(int(floor(In.uv.x * notesCount + 0.5) + minNoteMajor) - 1, 74);
+		int minorLocalId = min(int(floor(In.uv.x * scene.notesCount + 0.5) + scene.minNoteMajor) - 1, 74);
 		// Handle black keys.
 		// Hide keys that are on the edges.
-		if(minorLocalId >= 0 && isMinor[minorLocalId] && In.uv.x > 0.5/notesCount && In.uv.x < 1.0 - 0.5/notesCount){
+		if(minorLocalId >= 0 && isMinor[minorLocalId] && In.uv.x > 0.5/scene.notesCount && In.uv.x < 1.0 - 0.5/scene.notesCount){
 			int minorId = minorIds[minorLocalId];
 			// Get the shift for non-centered minor keys.
-			vec2 shifts = minorsWidth * minorShift(minorId % 12);
+			vec2 shifts = scene.minorsWidth * minorShift(minorId % 12);
 			// Compensate total width.
-			float marginSize = minorsWidth * 1.2;
+			float marginSize = scene.minorsWidth * 1.2;
 			// Rescale UV to take shift into account.
-			float localUv = fract(In.uv.x * notesCount + 0.5);
+			float localUv = fract(In.uv.x * scene.notesCount + 0.5);
 			localUv = abs( (localUv - shifts.x) / (1.0 - shifts.x - shifts.y) * 2.0 - 1.0);
 			// Detect edges.
 			intensity = step(marginSize, localUv);
 			//float roundEdge = (1.0 - exp(50.0 * (-In.uv.y + 0.4)))*1.1;
 			//intensity += smoothstep(roundEdge - 0.1, roundEdge + 0.1, localUv);
 			//intensity = clamp(intensity, 0.0, 1.0);
-			int cidMinor = actives[minorId];
+			int cidMinor = texelFetch(actives, minorId).r;
 			if(highlightKeys && cidMinor >= 0){
-				frontColor = minorColor[cidMinor];
+				frontColor = palette.keysMinor[cidMinor];
 			}
 		}
 	}
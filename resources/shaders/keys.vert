@@ -6,8 +6,21 @@ out INTERFACE {
 	vec2 uv;
 } Out ;
 
-uniform float keyboardHeight = 0.25;
-uniform bool horizontalMode = false;
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
 
 vec2 flipIfNeeded(vec2 inPos){
 	return horizontalMode ? vec2(inPos.y, -inPos.x) : inPos;
@@ -17,7 +30,7 @@ void main(){
 	// Input are in -0.5,0.5
 	// We directly output the position.
 	// [-0.5, 0.5] to [-1, 2.0*keyboardHeight-1.0]
-	float yShift = keyboardHeight * (2.0 * v.y + 1.0) - 1.0;
+	float yShift = scene.keyboardHeight * (2.0 * v.y + 1.0) - 1.0;
 
 	vec2 pos2D = vec2(v.x*2.0, yShift);
 
@@ -8,13 +8,38 @@ in INTERFACE {
 	float channel;
 } In;
 
-uniform vec3 baseColor[SETS_COUNT];
-uniform vec3 minorColor[SETS_COUNT];
-uniform vec2 inverseScreenSize;
+layout(std140) uniform FrameData {
+	vec2 inverseScreenSize;
+	float time;
+	float scrollTime;
+} frame;
+
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
+
+layout(std140) uniform PaletteData {
+	vec3 notesMajor[SETS_COUNT];
+	vec3 notesMinor[SETS_COUNT];
+	vec3 flashes[SETS_COUNT];
+	vec3 particles[SETS_COUNT];
+	vec3 keysMajor[SETS_COUNT];
+	vec3 keysMinor[SETS_COUNT];
+} palette;
+
 uniform float colorScale;
-uniform float keyboardHeight = 0.25;
-uniform float fadeOut = 0.0;
-uniform bool horizontalMode = false;
 
 #define cornerRadius 0.01
 
@@ -24,9 +49,9 @@ out vec4 fragColor;
 void main(){
 	
 	// If lower area of the screen, discard fragment as it should be hidden behind the keyboard.
-	vec2 normalizedCoord = vec2(gl_FragCoord.xy) * inverseScreenSize;
+	vec2 normalizedCoord = vec2(gl_FragCoord.xy) * frame.inverseScreenSize;
 
-	if((horizontalMode ? normalizedCoord.x : normalizedCoord.y) < keyboardHeight){
+	if((horizontalMode ? normalizedCoord.x : normalizedCoord.y) < scene.keyboardHeight){
 		discard;
 	}
 	
@@ -39,7 +64,7 @@ void main(){
 	
 	// Fragment color.
 	int cid = int(In.channel);
-	fragColor.rgb = colorScale * mix(baseColor[cid], minorColor[cid], In.isMinor);
+	fragColor.rgb = colorScale * mix(palette.notesMajor[cid], palette.notesMinor[cid], In.isMinor);
 	
 	if(	radiusPosition > 0.8){
 		fragColor.rgb *= 1.05;
@@ -47,7 +72,7 @@ void main(){
 
 
 	float distFromBottom = horizontalMode ? normalizedCoord.x : normalizedCoord.y;
-	float fadeOutFinal = min(fadeOut, 0.9999);
+	float fadeOutFinal = min(scene.fadeOut, 0.9999);
 	distFromBottom = max(distFromBottom - fadeOutFinal, 0.0) / (1.0 - fadeOutFinal);
 	float alpha = 1.0 - distFromBottom;
 	fragColor.a = alpha;
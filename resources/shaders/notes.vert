@@ -4,20 +4,37 @@ layout(location = 0) in vec2 v;
 layout(location = 1) in vec4 id; //note id, start, duration, is minor
 layout(location = 2) in float channel; //note id, start, duration, is minor
 
-uniform float time;
-uniform float mainSpeed;
-uniform float minorsWidth = 1.0;
-uniform float keyboardHeight = 0.25;
-uniform bool reverseMode = false;
-uniform bool horizontalMode = false;
+layout(std140) uniform FrameData {
+	vec2 inverseScreenSize;
+	float time;
+	float scrollTime;
+} frame;
+
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
+#ifdef REVERSE_MODE
+const bool reverseMode = true;
+#else
+const bool reverseMode = false;
+#endif
 
 vec2 flipIfNeeded(vec2 inPos){
 	return horizontalMode ? vec2(inPos.y, -inPos.x) : inPos;
 }
 
-uniform int minNoteMajor;
-uniform float notesCount;
-
 out INTERFACE {
 	vec2 uv;
 	vec2 noteSize;
@@ -28,9 +45,9 @@ out INTERFACE {
 
 void main(){
 	
-	float scalingFactor = id.w != 0.0 ? minorsWidth : 1.0;
+	float scalingFactor = id.w != 0.0 ? scene.minorsWidth : 1.0;
 	// Size of the note : width, height based on duration and current speed.
-	Out.noteSize = vec2(0.9*2.0/notesCount * scalingFactor, id.z*mainSpeed);
+	Out.noteSize = vec2(0.9*2.0/scene.notesCount * scalingFactor, id.z*scene.mainSpeed);
 	
 	// Compute note shift.
 	// Horizontal shift based on note id, width of keyboard, and if the note is minor or not.
@@ -41,11 +58,11 @@ void main(){
 	// input: id.x is in [0 MAJOR_COUNT]
 	// we want minNote to -1+1/c, maxNote to 1-1/c
 	float a = 2.0;
-	float b = -notesCount + 1.0 - 2.0 * float(minNoteMajor);
+	float b = -scene.notesCount + 1.0 - 2.0 * float(scene.minNoteMajor);
 
-	float horizLoc = (id.x * a + b + id.w) / notesCount;
-	float vertLoc = 2.0 * keyboardHeight - 1.0;
-	vertLoc += (reverseMode ? -1.0 : 1.0) * (Out.noteSize.y * 0.5 + mainSpeed * (id.y - time));
+	float horizLoc = (id.x * a + b + id.w) / scene.notesCount;
+	float vertLoc = 2.0 * scene.keyboardHeight - 1.0;
+	vertLoc += (reverseMode ? -1.0 : 1.0) * (Out.noteSize.y * 0.5 + scene.mainSpeed * (id.y - frame.scrollTime));
 	vec2 noteShift = vec2(horizLoc, vertLoc);
 	
 	// Scale uv.
@@ -3,27 +3,50 @@
 
 layout(location = 0) in vec2 v;
 
-uniform float time;
 uniform float scale;
-uniform vec3 baseColor[SETS_COUNT];
-uniform vec2 inverseScreenSize;
 uniform sampler2D textureParticles;
 uniform vec2 inverseTextureSize;
 
-uniform int globalId;
-uniform float duration;
-uniform int channel;
+// Live systems: note, set, elapsed time and duration.
+uniform samplerBuffer systems;
+uniform int particlesPerSystem;
 
 uniform int texCount;
 uniform float colorScale;
 
 uniform float expansionFactor = 1.0;
 uniform float speedScaling = 0.2;
-uniform float keyboardHeight = 0.25;
 
-uniform int minNote;
-uniform float notesCount;
-uniform bool horizontalMode = false;
+layout(std140) uniform FrameData {
+	vec2 inverseScreenSize;
+	float time;
+	float scrollTime;
+} frame;
+
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
+
+layout(std140) uniform PaletteData {
+	vec3 notesMajor[SETS_COUNT];
+	vec3 notesMinor[SETS_COUNT];
+	vec3 flashes[SETS_COUNT];
+	vec3 particles[SETS_COUNT];
+	vec3 keysMajor[SETS_COUNT];
+	vec3 keysMinor[SETS_COUNT];
+} palette;
 
 vec2 flipIfNeeded(vec2 inPos){
 	return horizontalMode ? vec2(inPos.y, -inPos.x) : inPos;
@@ -46,16 +69,24 @@ float rand(vec2 co){
 
 
 void main(){
-	Out.id = float(gl_InstanceID % texCount);
+	// All systems are drawn at once, retrieve the current one.
+	int localId = gl_InstanceID % particlesPerSystem;
+	vec4 system = texelFetch(systems, gl_InstanceID / particlesPerSystem);
+	int globalId = int(system.x);
+	int channel = int(system.y);
+	float time = system.z;
+	float duration = system.w;
+
+	Out.id = float(localId % texCount);
 	Out.uv = v + 0.5;
 	// Fade color based on time.
-	Out.color = vec4(colorScale * baseColor[channel], 1.0-time*time);
+	Out.color = vec4(colorScale * palette.particles[channel], 1.0-time*time);
 	
 	float localTime = speedScaling * time * duration;
 	float particlesCount = 1.0/inverseTextureSize.y;
 	
 	// Pick particle id at random.
-	float particleId = float(gl_InstanceID) + floor(particlesCount * 10.0 * rand(vec2(globalId,globalId)));
+	float particleId = float(localId) + floor(particlesCount * 10.0 * rand(vec2(globalId,globalId)));
 	float textureId = mod(particleId,particlesCount);
 	float particleShift = floor(particleId/particlesCount);
 	
@@ -83,12 +114,12 @@ void main(){
 	shift.x *= max(0.5, pow(shift.y,0.3));
 	
 	// Horizontal shift is based on the note ID.
-	float xshift = -1.0 + ((shifts[globalId] - shifts[int(minNote)]) * 2.0 + 1.0) / notesCount;
+	float xshift = -1.0 + ((shifts[globalId] - shifts[scene.minNote]) * 2.0 + 1.0) / scene.notesCount;
 	//  Combine global shift (due to note id) and local shift (based on read position).
-	vec2 globalShift = vec2(xshift, (2.0 * keyboardHeight - 1.0)-0.02);
+	vec2 globalShift = vec2(xshift, (2.0 * scene.keyboardHeight - 1.0)-0.02);
 	vec2 localShift = 0.003 * scale * v + shift * duration * vec2(1.0,0.5);
 
-	float screenRatio = inverseScreenSize.y/inverseScreenSize.x;
+	float screenRatio = frame.inverseScreenSize.y/frame.inverseScreenSize.x;
 	vec2 screenScaling = vec2(1.0, horizontalMode ? (1.0/screenRatio) : screenRatio);
 
 	vec2 finalPos = globalShift + screenScaling * localShift;
@@ -0,0 +1,28 @@
+#version 330
+
+in INTERFACE {
+	vec2 uv;
+} In ;
+
+uniform sampler2D screenTexture;
+uniform vec2 inverseScreenSize;
+uniform float offset = 1.0;
+
+out vec4 fragColor;
+
+
+void main(){
+	
+	// Dual filter downsampling: the center and four diagonal samples, relying on bilinear
+	// interpolation to average 4 pixels for each of them.
+	vec2 halfPixel = 0.5 * offset * inverseScreenSize;
+
+	vec4 color = 4.0 * texture(screenTexture, In.uv);
+	color += texture(screenTexture, In.uv - halfPixel);
+	color += texture(screenTexture, In.uv + halfPixel);
+	color += texture(screenTexture, In.uv + vec2(halfPixel.x, -halfPixel.y));
+	color += texture(screenTexture, In.uv - vec2(halfPixel.x, -halfPixel.y));
+
+	fragColor = color / 8.0;
+	
+}
@@ -0,0 +1,39 @@
+#version 330
+
+in INTERFACE {
+	vec2 uv;
+} In ;
+
+uniform sampler2D screenTexture;
+uniform vec2 inverseScreenSize;
+uniform float offset = 1.0;
+uniform bool lastLevel = false;
+uniform vec3 backgroundColor = vec3(0.0);
+uniform float attenuationFactor = 0.99;
+
+out vec4 fragColor;
+
+
+void main(){
+	
+	// Dual filter upsampling: a ring of eight samples around the current pixel, the diagonal ones weighted twice.
+	vec2 halfPixel = 0.5 * offset * inverseScreenSize;
+
+	vec4 color = texture(screenTexture, In.uv + vec2(-2.0 * halfPixel.x, 0.0));
+	color += texture(screenTexture, In.uv + vec2(2.0 * halfPixel.x, 0.0));
+	color += texture(screenTexture, In.uv + vec2(0.0, -2.0 * halfPixel.y));
+	color += texture(screenTexture, In.uv + vec2(0.0, 2.0 * halfPixel.y));
+	color += 2.0 * texture(screenTexture, In.uv + vec2(-halfPixel.x, halfPixel.y));
+	color += 2.0 * texture(screenTexture, In.uv + vec2(halfPixel.x, halfPixel.y));
+	color += 2.0 * texture(screenTexture, In.uv + vec2(halfPixel.x, -halfPixel.y));
+	color += 2.0 * texture(screenTexture, In.uv + vec2(-halfPixel.x, -halfPixel.y));
+	color /= 12.0;
+
+	// Include decay for fade out, once for the whole chain.
+	// The previous separable blur applied it in each of its two passes, keep the same fading speed.
+	if(lastLevel){
+		color = mix(vec4(backgroundColor, 0.0), color, attenuationFactor * attenuationFactor);
+	}
+	fragColor = color;
+	
+}
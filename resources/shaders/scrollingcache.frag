@@ -0,0 +1,16 @@
+#version 330
+
+in INTERFACE {
+	vec2 uv;
+} In ;
+
+uniform sampler2D screenTexture;
+uniform vec2 offset;
+
+out vec4 fragColor;
+
+
+void main(){
+	// The cache has the same pixel density as the screen and is only shifted by whole pixels.
+	fragColor = texelFetch(screenTexture, ivec2(gl_FragCoord.xy + offset), 0);
+}
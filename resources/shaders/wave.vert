@@ -2,12 +2,26 @@
 
 layout(location = 0) in vec2 v;
 
+layout(std140) uniform SceneData {
+	float keyboardHeight;
+	float notesCount;
+	int minNote;
+	int minNoteMajor;
+	float mainSpeed;
+	float minorsWidth;
+	float fadeOut;
+} scene;
+
+#ifdef HORIZONTAL_MODE
+const bool horizontalMode = true;
+#else
+const bool horizontalMode = false;
+#endif
+
 uniform float amplitude;
-uniform float keyboardSize;
 uniform float freq;
 uniform float phase;
 uniform float spread;
-uniform bool horizontalMode = false;
 
 vec2 flipIfNeeded(vec2 inPos){
 	return horizontalMode ? vec2(inPos.y, -inPos.x) : inPos;
@@ -24,7 +38,7 @@ void main(){
 	// Sin perturbation.
 	float waveShift = amplitude * sin(freq * v.x + phase);
 	// Apply wave and translate to put on top of the keyboard.
-	pos += vec2(0.0, waveShift + (-1.0 + 2.0 * keyboardSize));
+	pos += vec2(0.0, waveShift + (-1.0 + 2.0 * scene.keyboardHeight));
 	gl_Position = vec4(flipIfNeeded(pos), 0.5, 1.0);
 	Out.grad = v.y;
 }
@@ -69,6 +69,10 @@ Configuration::Configuration(const std::string& path, const std::vector<std::str
 				showVersion = true;
 				continue;
 			}
+			if(name == "trace" && vals.size() >= 1){
+				tracePath = join(vals, " ");
+				continue;
+			}
 		}
 		// Window options
 		{
@@ -117,15 +121,28 @@ Configuration::Configuration(const std::string& path, const std::vector<std::str
 			if(name == "export" && vals.size() >= 1){
 				exporting.path = join(vals, " ");
 			}
+			if(name == "headless"){
+				headless = vals.empty() || Configuration::parseBool(vals[0]);
+			}
 			if(name == "framerate" && vals.size() >= 1){
 				exporting.framerate = Configuration::parseInt(vals[0]);
 			}
 			if(name == "bitrate" && vals.size() >= 1){
 				exporting.bitrate = Configuration::parseInt(vals[0]);
 			}
+			if(name == "compression" && vals.size() >= 1){
+				exporting.compression = glm::clamp(Configuration::parseInt(vals[0]), 0, 9);
+			}
 			if(name == "postroll" && vals.size() >= 1){
 				exporting.postroll = Configuration::parseFloat(vals[0]);
 			}
+			if(name == "export-range" && vals.size() >= 2){
+				exporting.rangeStart = (std::max)(Configuration::parseFloat(vals[0]), 0.0f);
+				exporting.rangeEnd = Configuration::parseFloat(vals[1]);
+			}
+			if(name == "concat" && vals.size() >= 2){
+				concatPaths = vals;
+			}
 			if(name == "fix-premultiply"){
 				exporting.fixPremultiply = vals.empty() || Configuration::parseBool(vals[0]);
 			}
@@ -139,6 +156,16 @@ Configuration::Configuration(const std::string& path, const std::vector<std::str
 					exporting.format = Export::Format::MPEG4;
 				} else if(vals[0] == "PRORES"){
 					exporting.format = Export::Format::PRORES;
+				} else if(vals[0] == "TGA"){
+					exporting.format = Export::Format::TGA;
+				} else if(vals[0] == "PPM"){
+					exporting.format = Export::Format::PPM;
+				} else if(vals[0] == "QOI"){
+					exporting.format = Export::Format::QOI;
+				} else if(vals[0] == "RAW"){
+					exporting.format = Export::Format::RAW;
+				} else if(vals[0] == "Y4M"){
+					exporting.format = Export::Format::Y4M;
 				}
 			}
 		}
@@ -276,17 +303,22 @@ void Configuration::printHelp(){
 		{"forbid-transparency", "prevent transparent window background (1 or 0 to enable/disable)"},
 		{"help", "display this help message"},
 		{"version", "display the executable version and configuration"},
+		{"trace", "path to a JSON file to write a CPU trace to, in Chrome trace-event format"},
 	};
 
 	const std::vector<std::pair<std::string, std::string>> expOpts = {
-		{"export", "path to the output video (or directory for PNG)"},
-		{"format", "output format (values: PNG, MPEG2, MPEG4, PRORES)"},
+		{"export", "path to the output video (or directory for images, or - to stream to the standard output)"},
+		{"format", "output format (values: PNG, TGA, PPM, QOI, MPEG2, MPEG4, PRORES, RAW, Y4M)"},
 		{"framerate", "number of frames per second to export (integer)"},
 		{"bitrate", "target video bitrate in Mb (integer)"},
+		{"compression", "PNG compression level, from 0 (fastest) to 9 (smallest files) (integer, default 6)"},
 		{"postroll", "Postroll time after the track, in seconds (number, default 10.0)"},
-		{"out-alpha", "use transparent output background, only for PNG and PRORES (1 or 0 to enable/disable)"},
+		{"export-range", "only export a segment, in seconds from the beginning of the export (--export-range start end, negative end for the rest of the export)"},
+		{"concat", "join exported segments, in order, then quit (--concat output segment1 segment2 ...)"},
+		{"out-alpha", "use transparent output background, only for PNG, TGA, QOI and PRORES (1 or 0 to enable/disable)"},
 		{"fix-premultiply", "cancel alpha premultiplication, only when out-alpha is enabled (1 or 0 to enable/disable)"},
 		{"hide-window", "do not display the window (1 or 0 to enable/disable)"},
+		{"headless", "export without any window or display server, using EGL or OSMesa (Linux only, 1 or 0 to enable/disable)"},
 	};
 
 	std::cout << "---- Infos ---- MIDIVisualizer v" << MIDIVIZ_VERSION_MAJOR << "." << MIDIVIZ_VERSION_MINOR << " --------" << std::endl
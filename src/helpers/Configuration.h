@@ -16,7 +16,7 @@ std::string join(const std::vector<std::string>& strs, const std::string& delim)
 struct Export {
 
 	enum class Format : int {
-		   PNG = 0, MPEG2 = 1, MPEG4 = 2, PRORES = 3
+		   PNG = 0, MPEG2 = 1, MPEG4 = 2, PRORES = 3, TGA = 4, PPM = 5, QOI = 6, RAW = 7, Y4M = 8
 	};
 
 	std::string path;
@@ -24,8 +24,11 @@ struct Export {
 	float postroll = 10.0f;
 	int framerate = 60;
 	int bitrate = 40;
+	int compression = 6; ///< PNG compression level, from 0 (stored) to 9.
 	bool fixPremultiply = false;
 	bool alphaBackground = false;
+	float rangeStart = 0.0f; ///< Start of the exported part, in seconds of the whole export.
+	float rangeEnd = -1.0f; ///< End of the exported part, negative to export until the end.
 
 };
 
@@ -76,6 +79,11 @@ public:
 
 	// Export settings (won't be saved)
 	Export exporting;
+	bool headless = false;
+	std::vector<std::string> concatPaths; ///< Output then exported segments to join into it.
+
+	// Debug settings (won't be saved)
+	std::string tracePath;
 
 private:
 
@@ -0,0 +1,330 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "HeadlessContext.h"
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#define MIDIVIZ_SUPPORT_HEADLESS
+#endif
+
+void * HeadlessContext::_library = nullptr;
+void * HeadlessContext::_glLibrary = nullptr;
+GL3WglProc (*HeadlessContext::_getProc)(const char *) = nullptr;
+
+#ifdef MIDIVIZ_SUPPORT_HEADLESS
+
+// Subset of the EGL and OSMesa APIs, declared here as their headers might not be installed.
+namespace {
+
+	typedef int32_t EGLint;
+	typedef unsigned int EGLBoolean;
+	typedef unsigned int EGLenum;
+	typedef void * EGLDisplay;
+	typedef void * EGLConfig;
+	typedef void * EGLContext;
+	typedef void * EGLSurface;
+	typedef void * EGLDeviceEXT;
+
+	const EGLint EGL_NONE = 0x3038;
+	const EGLint EGL_EXTENSIONS = 0x3055;
+	const EGLint EGL_RED_SIZE = 0x3024;
+	const EGLint EGL_GREEN_SIZE = 0x3023;
+	const EGLint EGL_BLUE_SIZE = 0x3022;
+	const EGLint EGL_ALPHA_SIZE = 0x3021;
+	const EGLint EGL_SURFACE_TYPE = 0x3033;
+	const EGLint EGL_PBUFFER_BIT = 0x0001;
+	const EGLint EGL_RENDERABLE_TYPE = 0x3040;
+	const EGLint EGL_OPENGL_BIT = 0x0008;
+	const EGLint EGL_WIDTH = 0x3057;
+	const EGLint EGL_HEIGHT = 0x3056;
+	const EGLint EGL_CONTEXT_MAJOR_VERSION = 0x3098;
+	const EGLint EGL_CONTEXT_MINOR_VERSION = 0x30FB;
+	const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD;
+	const EGLint EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+	const EGLenum EGL_OPENGL_API = 0x30A2;
+	const EGLenum EGL_PLATFORM_DEVICE_EXT = 0x313F;
+	const EGLenum EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+
+	typedef GL3WglProc (*PFNEGLGETPROCADDRESS)(const char *);
+	typedef EGLDisplay (*PFNEGLGETDISPLAY)(void *);
+	typedef EGLDisplay (*PFNEGLGETPLATFORMDISPLAYEXT)(EGLenum, void *, const EGLint *);
+	typedef EGLBoolean (*PFNEGLQUERYDEVICESEXT)(EGLint, EGLDeviceEXT *, EGLint *);
+	typedef const char * (*PFNEGLQUERYSTRING)(EGLDisplay, EGLint);
+	typedef EGLBoolean (*PFNEGLINITIALIZE)(EGLDisplay, EGLint *, EGLint *);
+	typedef EGLBoolean (*PFNEGLTERMINATE)(EGLDisplay);
+	typedef EGLBoolean (*PFNEGLBINDAPI)(EGLenum);
+	typedef EGLBoolean (*PFNEGLCHOOSECONFIG)(EGLDisplay, const EGLint *, EGLConfig *, EGLint, EGLint *);
+	typedef EGLContext (*PFNEGLCREATECONTEXT)(EGLDisplay, EGLConfig, EGLContext, const EGLint *);
+	typedef EGLBoolean (*PFNEGLDESTROYCONTEXT)(EGLDisplay, EGLContext);
+	typedef EGLSurface (*PFNEGLCREATEPBUFFERSURFACE)(EGLDisplay, EGLConfig, const EGLint *);
+	typedef EGLBoolean (*PFNEGLDESTROYSURFACE)(EGLDisplay, EGLSurface);
+	typedef EGLBoolean (*PFNEGLMAKECURRENT)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
+
+	const int OSMESA_FORMAT = 0x22;
+	const int OSMESA_DEPTH_BITS = 0x30;
+	const int OSMESA_PROFILE = 0x33;
+	const int OSMESA_CORE_PROFILE = 0x34;
+	const int OSMESA_CONTEXT_MAJOR_VERSION = 0x36;
+	const int OSMESA_CONTEXT_MINOR_VERSION = 0x37;
+
+	typedef void * OSMesaContext;
+	typedef OSMesaContext (*PFNOSMESACREATECONTEXTATTRIBS)(const int *, OSMesaContext);
+	typedef GLboolean (*PFNOSMESAMAKECURRENT)(OSMesaContext, void *, GLenum, GLsizei, GLsizei);
+	typedef void (*PFNOSMESADESTROYCONTEXT)(OSMesaContext);
+	typedef GL3WglProc (*PFNOSMESAGETPROCADDRESS)(const char *);
+
+	template<typename T>
+	T loadSymbol(void * library, const char * name){
+		return reinterpret_cast<T>(dlsym(library, name));
+	}
+
+	bool hasExtension(const char * extensions, const std::string & name){
+		if(extensions == nullptr){
+			return false;
+		}
+		const std::string list = " " + std::string(extensions) + " ";
+		return list.find(" " + name + " ") != std::string::npos;
+	}
+
+	void * openLibrary(const std::vector<std::string> & names){
+		for(const auto & name : names){
+			void * library = dlopen(name.c_str(), RTLD_NOW | RTLD_LOCAL);
+			if(library){
+				return library;
+			}
+		}
+		return nullptr;
+	}
+}
+
+bool HeadlessContext::init(){
+	if(initEGL()){
+		return true;
+	}
+	if(initOSMesa()){
+		return true;
+	}
+	std::cerr << "[HEADLESS]: Unable to create an offscreen OpenGL context (EGL or OSMesa)." << std::endl;
+	return false;
+}
+
+bool HeadlessContext::initEGL(){
+	_library = openLibrary({"libEGL.so.1", "libEGL.so"});
+	if(!_library){
+		return false;
+	}
+	PFNEGLGETPROCADDRESS eglGetProcAddress = loadSymbol<PFNEGLGETPROCADDRESS>(_library, "eglGetProcAddress");
+	PFNEGLGETDISPLAY eglGetDisplay = loadSymbol<PFNEGLGETDISPLAY>(_library, "eglGetDisplay");
+	PFNEGLQUERYSTRING eglQueryString = loadSymbol<PFNEGLQUERYSTRING>(_library, "eglQueryString");
+	PFNEGLINITIALIZE eglInitialize = loadSymbol<PFNEGLINITIALIZE>(_library, "eglInitialize");
+	PFNEGLTERMINATE eglTerminate = loadSymbol<PFNEGLTERMINATE>(_library, "eglTerminate");
+	PFNEGLBINDAPI eglBindAPI = loadSymbol<PFNEGLBINDAPI>(_library, "eglBindAPI");
+	PFNEGLCHOOSECONFIG eglChooseConfig = loadSymbol<PFNEGLCHOOSECONFIG>(_library, "eglChooseConfig");
+	PFNEGLCREATECONTEXT eglCreateContext = loadSymbol<PFNEGLCREATECONTEXT>(_library, "eglCreateContext");
+	PFNEGLCREATEPBUFFERSURFACE eglCreatePbufferSurface = loadSymbol<PFNEGLCREATEPBUFFERSURFACE>(_library, "eglCreatePbufferSurface");
+	PFNEGLMAKECURRENT eglMakeCurrent = loadSymbol<PFNEGLMAKECURRENT>(_library, "eglMakeCurrent");
+	if(!eglGetProcAddress || !eglGetDisplay || !eglQueryString || !eglInitialize || !eglTerminate || !eglBindAPI
+	   || !eglChooseConfig || !eglCreateContext || !eglCreatePbufferSurface || !eglMakeCurrent){
+		dlclose(_library);
+		_library = nullptr;
+		return false;
+	}
+
+	// Pick a display that doesn't need a window system: a GPU device, else Mesa's surfaceless platform.
+	const char * clientExtensions = eglQueryString(nullptr, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXT eglGetPlatformDisplayEXT = nullptr;
+	if(hasExtension(clientExtensions, "EGL_EXT_platform_base")){
+		eglGetPlatformDisplayEXT = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXT>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	}
+	std::vector<std::pair<EGLDisplay, std::string>> displays;
+	if(eglGetPlatformDisplayEXT && hasExtension(clientExtensions, "EGL_EXT_platform_device")){
+		PFNEGLQUERYDEVICESEXT eglQueryDevicesEXT = reinterpret_cast<PFNEGLQUERYDEVICESEXT>(eglGetProcAddress("eglQueryDevicesEXT"));
+		EGLDeviceEXT devices[8];
+		EGLint count = 0;
+		if(eglQueryDevicesEXT && eglQueryDevicesEXT(8, devices, &count)){
+			for(EGLint did = 0; did < count; ++did){
+				displays.emplace_back(eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, devices[did], nullptr), "EGL device " + std::to_string(did));
+			}
+		}
+	}
+	if(eglGetPlatformDisplayEXT && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")){
+		displays.emplace_back(eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr), "EGL surfaceless");
+	}
+	displays.emplace_back(eglGetDisplay(nullptr), "EGL default display");
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	const EGLint pbufferAttribs[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+
+	for(const auto & display : displays){
+		if(display.first == nullptr || !eglInitialize(display.first, nullptr, nullptr)){
+			continue;
+		}
+		if(!eglBindAPI(EGL_OPENGL_API)){
+			eglTerminate(display.first);
+			continue;
+		}
+		EGLConfig config = nullptr;
+		EGLint configsCount = 0;
+		if(!eglChooseConfig(display.first, configAttribs, &config, 1, &configsCount) || configsCount == 0){
+			// Surfaceless displays can have no pbuffer config, any config will do without a surface.
+			const EGLint anyAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+			if(!eglChooseConfig(display.first, anyAttribs, &config, 1, &configsCount) || configsCount == 0){
+				config = nullptr;
+			}
+		}
+		EGLContext context = eglCreateContext(display.first, config, nullptr, contextAttribs);
+		if(context == nullptr){
+			eglTerminate(display.first);
+			continue;
+		}
+		// Render without a default framebuffer if possible, else to a small pbuffer.
+		EGLSurface surface = nullptr;
+		bool current = false;
+		if(hasExtension(eglQueryString(display.first, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")){
+			current = eglMakeCurrent(display.first, nullptr, nullptr, context);
+		}
+		if(!current && config != nullptr){
+			surface = eglCreatePbufferSurface(display.first, config, pbufferAttribs);
+			current = surface != nullptr && eglMakeCurrent(display.first, surface, surface, context);
+		}
+		if(!current){
+			PFNEGLDESTROYCONTEXT eglDestroyContext = loadSymbol<PFNEGLDESTROYCONTEXT>(_library, "eglDestroyContext");
+			if(eglDestroyContext){
+				eglDestroyContext(display.first, context);
+			}
+			eglTerminate(display.first);
+			continue;
+		}
+
+		_display = display.first;
+		_context = context;
+		_surface = surface;
+		_backend = display.second;
+		_getProc = eglGetProcAddress;
+		_glLibrary = openLibrary({"libOpenGL.so.0", "libGL.so.1"});
+		return true;
+	}
+	dlclose(_library);
+	_library = nullptr;
+	return false;
+}
+
+bool HeadlessContext::initOSMesa(){
+	_library = openLibrary({"libOSMesa.so.8", "libOSMesa.so.6", "libOSMesa.so"});
+	if(!_library){
+		return false;
+	}
+	PFNOSMESACREATECONTEXTATTRIBS OSMesaCreateContextAttribs = loadSymbol<PFNOSMESACREATECONTEXTATTRIBS>(_library, "OSMesaCreateContextAttribs");
+	PFNOSMESAMAKECURRENT OSMesaMakeCurrent = loadSymbol<PFNOSMESAMAKECURRENT>(_library, "OSMesaMakeCurrent");
+	PFNOSMESAGETPROCADDRESS OSMesaGetProcAddress = loadSymbol<PFNOSMESAGETPROCADDRESS>(_library, "OSMesaGetProcAddress");
+	if(!OSMesaCreateContextAttribs || !OSMesaMakeCurrent || !OSMesaGetProcAddress){
+		dlclose(_library);
+		_library = nullptr;
+		return false;
+	}
+	const int attribs[] = {
+		OSMESA_FORMAT, GL_RGBA,
+		OSMESA_DEPTH_BITS, 0,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 3,
+		OSMESA_CONTEXT_MINOR_VERSION, 3,
+		0
+	};
+	OSMesaContext context = OSMesaCreateContextAttribs(attribs, nullptr);
+	if(context == nullptr){
+		dlclose(_library);
+		_library = nullptr;
+		return false;
+	}
+	_osmesaBuffer.resize(16 * 16 * 4);
+	if(!OSMesaMakeCurrent(context, _osmesaBuffer.data(), GL_UNSIGNED_BYTE, 16, 16)){
+		PFNOSMESADESTROYCONTEXT OSMesaDestroyContext = loadSymbol<PFNOSMESADESTROYCONTEXT>(_library, "OSMesaDestroyContext");
+		if(OSMesaDestroyContext){
+			OSMesaDestroyContext(context);
+		}
+		dlclose(_library);
+		_library = nullptr;
+		return false;
+	}
+	_context = context;
+	_backend = "OSMesa";
+	_getProc = OSMesaGetProcAddress;
+	return true;
+}
+
+void HeadlessContext::clean(){
+	if(_library == nullptr){
+		return;
+	}
+	if(_display != nullptr){
+		PFNEGLMAKECURRENT eglMakeCurrent = loadSymbol<PFNEGLMAKECURRENT>(_library, "eglMakeCurrent");
+		PFNEGLDESTROYSURFACE eglDestroySurface = loadSymbol<PFNEGLDESTROYSURFACE>(_library, "eglDestroySurface");
+		PFNEGLDESTROYCONTEXT eglDestroyContext = loadSymbol<PFNEGLDESTROYCONTEXT>(_library, "eglDestroyContext");
+		PFNEGLTERMINATE eglTerminate = loadSymbol<PFNEGLTERMINATE>(_library, "eglTerminate");
+		eglMakeCurrent(_display, nullptr, nullptr, nullptr);
+		if(_surface != nullptr){
+			eglDestroySurface(_display, _surface);
+		}
+		eglDestroyContext(_display, _context);
+		eglTerminate(_display);
+	} else if(_context != nullptr){
+		PFNOSMESADESTROYCONTEXT OSMesaDestroyContext = loadSymbol<PFNOSMESADESTROYCONTEXT>(_library, "OSMesaDestroyContext");
+		OSMesaDestroyContext(_context);
+	}
+	_display = _context = _surface = nullptr;
+	_getProc = nullptr;
+	if(_glLibrary != nullptr){
+		dlclose(_glLibrary);
+		_glLibrary = nullptr;
+	}
+	dlclose(_library);
+	_library = nullptr;
+}
+
+GL3WglProc HeadlessContext::getProcAddress(const char * name){
+	// Prefer the exported core entry points, some EGL implementations only return extensions.
+	if(_glLibrary != nullptr){
+		void * proc = dlsym(_glLibrary, name);
+		if(proc != nullptr){
+			return reinterpret_cast<GL3WglProc>(proc);
+		}
+	}
+	return _getProc != nullptr ? _getProc(name) : nullptr;
+}
+
+#else
+
+bool HeadlessContext::init(){
+	std::cerr << "[HEADLESS]: Headless rendering is only supported on Linux." << std::endl;
+	return false;
+}
+
+bool HeadlessContext::initEGL(){
+	return false;
+}
+
+bool HeadlessContext::initOSMesa(){
+	return false;
+}
+
+void HeadlessContext::clean(){
+}
+
+GL3WglProc HeadlessContext::getProcAddress(const char *){
+	return nullptr;
+}
+
+#endif
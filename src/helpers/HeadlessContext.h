@@ -0,0 +1,45 @@
+#ifndef HeadlessContext_h
+#define HeadlessContext_h
+
+#include <gl3w/gl3w.h>
+#include <string>
+#include <vector>
+
+/// Offscreen OpenGL context created without any window system, for exports on machines without a display.
+/// An EGL context is tried first (GPU device, then Mesa surfaceless platform), then OSMesa.
+/// Libraries are loaded at runtime so that the executable doesn't depend on them.
+class HeadlessContext {
+
+public:
+
+	/// Create a 3.2+ core context and make it current.
+	bool init();
+
+	/// Backend used by the current context.
+	const std::string & backend() const { return _backend; }
+
+	/// Release the context.
+	void clean();
+
+	/// Function loader for the current context, to pass to gl3wInit2.
+	static GL3WglProc getProcAddress(const char * name);
+
+private:
+
+	bool initEGL();
+
+	bool initOSMesa();
+
+	std::string _backend;
+
+	void * _display = nullptr;
+	void * _context = nullptr;
+	void * _surface = nullptr;
+	std::vector<unsigned char> _osmesaBuffer; ///< OSMesa requires a color buffer, we only render to framebuffers.
+
+	static void * _library; ///< EGL or OSMesa.
+	static void * _glLibrary; ///< Core GL entry points, if available.
+	static GL3WglProc (*_getProc)(const char *);
+};
+
+#endif
@@ -121,6 +121,10 @@ GLuint createGLProgramFromStrings(const std::string & vertexContent, const std::
 	}
 	
 	
+	// Allow the driver to keep the linked binary around for the program cache.
+	if(glProgramParameteri){
+		glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	// Link everything
 	glLinkProgram(id);
 	checkGLError();
@@ -1,5 +1,8 @@
 #include "Recorder.h"
 #include "../rendering/State.h"
+#include "Trace.h"
+#include "System.h"
+#include "../rendering/GLState.h"
 
 #include <imgui/imgui.h>
 #include <nfd.h>
@@ -8,127 +11,289 @@
 #include <iostream>
 #include <stdio.h>
 #include <vector>
+#include <cstring>
 #include <unordered_map>
 #include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <signal.h>
+#endif
 
 #ifdef MIDIVIZ_SUPPORT_VIDEO
 extern "C" {
 	#include <libavcodec/avcodec.h>
 	#include <libavformat/avformat.h>
 	#include <libavformat/avio.h>
-	#include <libswscale/swscale.h>
+	#include <libavutil/pixdesc.h>
 	#include <libavutil/opt.h>
 }
 #endif
 
 // Helpers for multithreading.
 
-void convertImageInPlace(std::vector<GLubyte>& buffer, const glm::ivec2 size, bool exportNoBackground, bool cancelPremultiply){
-
-	// Copy and flip rows.
-	int width = size[0];
-	int height = size[1];
-
-	for (int y = 0; y < height/2; ++y) {
-	   const int top = y * width * 4;
-	   const int topNext = (y+1) * width * 4;
-	   const int bottom = (height - y - 1) * width * 4;
-	   std::swap_ranges(buffer.begin() + top, buffer.begin() + topNext, buffer.begin() + bottom);
-	}
-
-	// Cancel alpha premultiplication if requested.
-	if(exportNoBackground && cancelPremultiply){
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				const int baseInd = (y * width + x) * 4;
-				const float a = float(buffer[baseInd + 3]) / 255.0f;
-				if(a == 0.0){
-					continue;
-				}
-				float r = float(buffer[baseInd + 0]) / 255.0f;
-				float g = float(buffer[baseInd + 1]) / 255.0f;
-				float b = float(buffer[baseInd + 2]) / 255.0f;
-				r = glm::clamp(r / a, 0.0f, 1.0f);
-				g = glm::clamp(g / a, 0.0f, 1.0f);
-				b = glm::clamp(b / a, 0.0f, 1.0f);
-				buffer[baseInd + 0] = GLubyte(255.0f * r);
-				buffer[baseInd + 1] = GLubyte(255.0f * g);
-				buffer[baseInd + 2] = GLubyte(255.0f * b);
-			}
-		}
-	}
-
-	// Erase alpha channel if exporting opaque image.
-	if(!exportNoBackground){
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				const int baseInd = (y * width + x) * 4;
-				buffer[baseInd + 3] = 255;
-			}
-		}
+/// Move a completely written file to its final path, so that an interrupted export never leaves a truncated image.
+bool moveToPath(const std::string & tempPath, const std::string & outputFilePath){
+#ifdef _WIN32
+	// Renaming does not replace an existing file on Windows.
+	std::remove(outputFilePath.c_str());
+#endif
+	if(std::rename(tempPath.c_str(), outputFilePath.c_str()) != 0){
+		std::cerr << "[EXPORT]: Unable to write to " << outputFilePath << "." << std::endl;
+		std::remove(tempPath.c_str());
+		return false;
 	}
+	return true;
 }
 
-void writePNGToPath(std::vector<GLubyte>* buffer, const glm::ivec2 size, bool exportNoBackground, bool cancelPremultiply, const std::string outputFilePath){
-
-	convertImageInPlace(*buffer, size, exportNoBackground, cancelPremultiply);
+size_t writePNGToPath(std::vector<GLubyte>* buffer, const glm::ivec2 size, size_t channels, int compression, const std::string outputFilePath){
+	// The image has already been flipped and resolved on the GPU.
+	TRACE_SCOPE("Write PNG");
 
 	// LodePNG encoding settings.
 	LodePNGState state;
 	lodepng_state_init(&state);
-	state.info_raw.colortype = LCT_RGBA;
+	state.info_raw.colortype = channels == 4 ? LCT_RGBA : LCT_RGB;
 	state.info_raw.bitdepth = 8;
-	state.info_png.color.colortype = exportNoBackground ? LCT_RGBA : LCT_RGB;
+	state.info_png.color.colortype = state.info_raw.colortype;
 	state.info_png.color.bitdepth = 8;
+	// Compression level, 6 is the LodePNG default. Lower levels use a shorter search window,
+	// skip lazy matching and the color analysis; 0 stores the data uncompressed.
+	static const unsigned int windowSizes[10] = {2048, 256, 512, 1024, 1024, 2048, 2048, 4096, 8192, 32768};
+	compression = glm::clamp(compression, 0, 9);
+	LodePNGCompressSettings & zlib = state.encoder.zlibsettings;
+	zlib.btype = compression == 0 ? 0 : 2;
+	zlib.windowsize = windowSizes[compression];
+	zlib.lazymatching = compression >= 4 ? 1 : 0;
+	zlib.nicematch = compression < 4 ? 32 : (compression <= 6 ? 128 : 258);
+	state.encoder.filter_strategy = compression == 0 ? LFS_ZERO : (compression < 3 ? LFS_FOUR : LFS_MINSUM);
+	state.encoder.auto_convert = compression >= 6 ? 1 : 0;
 
 	// Encode
 	unsigned char* outBuffer = nullptr;
 	size_t outBufferSize = 0;
-	lodepng_encode(&outBuffer, &outBufferSize, buffer->data(), size[0], size[1], &state);
+	{
+		TRACE_SCOPE("Encode PNG");
+		lodepng_encode(&outBuffer, &outBufferSize, buffer->data(), size[0], size[1], &state);
+	}
 	unsigned int error = state.error;
 	lodepng_state_cleanup(&state);
 
 	// Save
+	const std::string tempPath = outputFilePath + ".part";
 	if(!error){
-		error = lodepng_save_file(outBuffer, outBufferSize, outputFilePath.c_str());
+		TRACE_SCOPE("Save PNG");
+		error = lodepng_save_file(outBuffer, outBufferSize, tempPath.c_str());
 	}
 	free(outBuffer);
 
 	if(error){
 		std::cerr << "[EXPORT]: PNG error " << error << ": " << lodepng_error_text(error) << std::endl;
+		std::remove(tempPath.c_str());
+		return 0;
 	}
+	return moveToPath(tempPath, outputFilePath) ? outBufferSize : 0;
 }
 
-void writeFrameToVideo(std::vector<GLubyte>* buffer, const glm::ivec2 size, bool exportNoBackground, bool cancelPremultiply, AVFrame* frame, SwsContext* swsContext, AVCodecContext* codecCtx, Recorder* recorder){
-#ifdef MIDIVIZ_SUPPORT_VIDEO
-	convertImageInPlace(*buffer, size, exportNoBackground, cancelPremultiply);
-
-	unsigned char * srcs[AV_NUM_DATA_POINTERS] = {0};
-	int strides[AV_NUM_DATA_POINTERS] = {0};
-	srcs[0] = (unsigned char *)buffer->data();
-	strides[0] = int(size[0] * 4);
-	// Rescale and convert to the proper output layout.
-	sws_scale(swsContext, srcs, strides, 0, size[1], frame->data, frame->linesize);
-	// Send frame.
-	const int res = avcodec_send_frame(codecCtx, frame);
-	if(res == AVERROR(EAGAIN)){
-		// Unavailable right now, should flush and retry.
-		if(recorder->flush()){
-			avcodec_send_frame(codecCtx, frame);
-		}
-	} else if(res < 0){
-		std::cerr << "[VIDEO]: Unable to send frame " << (frame->pts + 1) << "." << std::endl;
+size_t writeFile(const GLubyte * header, size_t headerSize, const GLubyte * data, size_t dataSize, const std::string & outputFilePath){
+	TRACE_SCOPE("Save image");
+	const std::string tempPath = outputFilePath + ".part";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if(!file){
+		std::cerr << "[EXPORT]: Unable to write to " << outputFilePath << "." << std::endl;
+		return 0;
 	}
-#endif
+	bool success = fwrite(header, 1, headerSize, file) == headerSize && fwrite(data, 1, dataSize, file) == dataSize;
+	success = (fclose(file) == 0) && success;
+	if(!success){
+		std::cerr << "[EXPORT]: Unable to write to " << outputFilePath << "." << std::endl;
+		std::remove(tempPath.c_str());
+		return 0;
+	}
+	return moveToPath(tempPath, outputFilePath) ? (headerSize + dataSize) : 0;
+}
+
+size_t writeTGAToPath(std::vector<GLubyte>* buffer, const glm::ivec2 size, size_t channels, const std::string outputFilePath){
+	// Uncompressed true-color, pixels are already in BGR(A) order.
+	GLubyte header[18] = {0};
+	header[2] = 2;
+	header[12] = GLubyte(size[0] & 0xFF);
+	header[13] = GLubyte((size[0] >> 8) & 0xFF);
+	header[14] = GLubyte(size[1] & 0xFF);
+	header[15] = GLubyte((size[1] >> 8) & 0xFF);
+	header[16] = GLubyte(8 * channels);
+	// Alpha bits count, and rows stored from the top.
+	header[17] = GLubyte((channels == 4 ? 8 : 0) | 0x20);
+	return writeFile(header, sizeof(header), buffer->data(), buffer->size(), outputFilePath);
+}
+
+std::string ppmHeader(const glm::ivec2 size){
+	// Binary RGB.
+	return "P6\n" + std::to_string(size[0]) + " " + std::to_string(size[1]) + "\n255\n";
+}
+
+size_t writePPMToPath(std::vector<GLubyte>* buffer, const glm::ivec2 size, const std::string outputFilePath){
+	const std::string header = ppmHeader(size);
+	return writeFile((const GLubyte*)header.data(), header.size(), buffer->data(), buffer->size(), outputFilePath);
+}
+
+size_t writeQOIToPath(std::vector<GLubyte>* buffer, const glm::ivec2 size, size_t channels, const std::string outputFilePath){
+	// Encoder for the Quite OK Image format (https://qoiformat.org/qoi-specification.pdf).
+	TRACE_SCOPE("Encode QOI");
+	const size_t pixelsCount = size_t(size[0]) * size_t(size[1]);
+	std::vector<GLubyte> data;
+	data.reserve(pixelsCount * (channels + 1) + 8);
+
+	GLubyte header[14] = {'q', 'o', 'i', 'f'};
+	for(int i = 0; i < 4; ++i){
+		header[4 + i] = GLubyte((uint32_t(size[0]) >> (24 - 8 * i)) & 0xFF);
+		header[8 + i] = GLubyte((uint32_t(size[1]) >> (24 - 8 * i)) & 0xFF);
+	}
+	header[12] = GLubyte(channels);
+	header[13] = 0;
+
+	GLubyte index[64][4] = {{0}};
+	GLubyte prev[4] = {0, 0, 0, 255};
+	GLubyte px[4] = {0, 0, 0, 255};
+	int run = 0;
+	const GLubyte * pixels = buffer->data();
+	for(size_t pid = 0; pid < pixelsCount; ++pid){
+		std::memcpy(px, pixels + pid * channels, channels);
+		if(std::memcmp(px, prev, 4) == 0){
+			++run;
+			if(run == 62 || pid + 1 == pixelsCount){
+				data.push_back(GLubyte(0xC0 | (run - 1)));
+				run = 0;
+			}
+			continue;
+		}
+		if(run > 0){
+			data.push_back(GLubyte(0xC0 | (run - 1)));
+			run = 0;
+		}
+		const int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+		if(std::memcmp(index[hash], px, 4) == 0){
+			data.push_back(GLubyte(hash));
+		} else {
+			std::memcpy(index[hash], px, 4);
+			if(px[3] == prev[3]){
+				const signed char dr = (signed char)(px[0] - prev[0]);
+				const signed char dg = (signed char)(px[1] - prev[1]);
+				const signed char db = (signed char)(px[2] - prev[2]);
+				const int drg = dr - dg;
+				const int dbg = db - dg;
+				if(dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2){
+					data.push_back(GLubyte(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+				} else if(drg > -9 && drg < 8 && dg > -33 && dg < 32 && dbg > -9 && dbg < 8){
+					data.push_back(GLubyte(0x80 | (dg + 32)));
+					data.push_back(GLubyte(((drg + 8) << 4) | (dbg + 8)));
+				} else {
+					data.push_back(0xFE);
+					data.insert(data.end(), px, px + 3);
+				}
+			} else {
+				data.push_back(0xFF);
+				data.insert(data.end(), px, px + 4);
+			}
+		}
+		std::memcpy(prev, px, 4);
+	}
+	// End marker.
+	const GLubyte padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+	data.insert(data.end(), padding, padding + 8);
+	return writeFile(header, sizeof(header), data.data(), data.size(), outputFilePath);
+}
+
+size_t writeImageToPath(std::vector<GLubyte>* buffer, const glm::ivec2 size, size_t channels, Export::Format format, int compression, const std::string outputFilePath){
+	switch(format){
+		case Export::Format::PNG:
+			return writePNGToPath(buffer, size, channels, compression, outputFilePath);
+		case Export::Format::TGA:
+			return writeTGAToPath(buffer, size, channels, outputFilePath);
+		case Export::Format::PPM:
+			return writePPMToPath(buffer, size, outputFilePath);
+		case Export::Format::QOI:
+			return writeQOIToPath(buffer, size, channels, outputFilePath);
+		default:
+			break;
+	}
+	return 0;
+}
+
+uint32_t readBigEndian(const GLubyte * bytes){
+	return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+}
+
+/// Check that an image written by a previous export is complete, from its size and markers without decoding it.
+bool isImageComplete(const std::string & path, Export::Format format, const glm::ivec2 size, size_t channels){
+	FILE* file = fopen(path.c_str(), "rb");
+	if(!file){
+		return false;
+	}
+	GLubyte header[32] = {0};
+	GLubyte trailer[12] = {0};
+	long fileSize = 0;
+	bool read = fseek(file, 0, SEEK_END) == 0;
+	read = read && (fileSize = ftell(file)) >= long(sizeof(header) + sizeof(trailer));
+	read = read && fseek(file, 0, SEEK_SET) == 0 && fread(header, 1, sizeof(header), file) == sizeof(header);
+	read = read && fseek(file, -long(sizeof(trailer)), SEEK_END) == 0 && fread(trailer, 1, sizeof(trailer), file) == sizeof(trailer);
+	fclose(file);
+	if(!read){
+		return false;
+	}
+
+	const size_t pixelsSize = size_t(size[0]) * size_t(size[1]);
+	switch(format){
+		case Export::Format::PNG:
+		{
+			// Signature, dimensions in the first chunk, and the final chunk.
+			static const GLubyte signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+			static const GLubyte end[12] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+			return std::memcmp(header, signature, sizeof(signature)) == 0 && std::memcmp(trailer, end, sizeof(end)) == 0
+				&& readBigEndian(header + 16) == uint32_t(size[0]) && readBigEndian(header + 20) == uint32_t(size[1]);
+		}
+		case Export::Format::TGA:
+			// Uncompressed, the file size is known.
+			return size_t(fileSize) == 18 + pixelsSize * channels && header[16] == GLubyte(8 * channels)
+				&& (header[12] | (header[13] << 8)) == size[0] && (header[14] | (header[15] << 8)) == size[1];
+		case Export::Format::PPM:
+		{
+			const std::string expected = ppmHeader(size);
+			return size_t(fileSize) == expected.size() + pixelsSize * 3
+				&& std::memcmp(header, expected.data(), (std::min)(expected.size(), sizeof(header))) == 0;
+		}
+		case Export::Format::QOI:
+		{
+			static const GLubyte end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+			return std::memcmp(header, "qoif", 4) == 0 && readBigEndian(header + 4) == uint32_t(size[0])
+				&& readBigEndian(header + 8) == uint32_t(size[1]) && header[12] == GLubyte(channels)
+				&& std::memcmp(trailer + 4, end, sizeof(end)) == 0;
+		}
+		default:
+			break;
+	}
+	return false;
 }
 
+FILE * Recorder::_standardOutput = nullptr;
+
 Recorder::Recorder(){
 	_formats = {
-		 {"PNG", "png", Export::Format::PNG},
+		{"PNG", "png", Export::Format::PNG, Output::IMAGES, true},
+		{"TGA", "tga", Export::Format::TGA, Output::IMAGES, true},
+		{"PPM", "ppm", Export::Format::PPM, Output::IMAGES, false},
+		{"QOI", "qoi", Export::Format::QOI, Output::IMAGES, true},
+		{"RAW", "rgba", Export::Format::RAW, Output::STREAM, true},
+		{"Y4M", "y4m", Export::Format::Y4M, Output::STREAM, false},
 	#ifdef MIDIVIZ_SUPPORT_VIDEO
-		{"MPEG2", "mp4", Export::Format::MPEG2},
-		{"MPEG4", "mp4", Export::Format::MPEG4},
-		{"PRORES", "mov", Export::Format::PRORES}
+		{"MPEG2", "mp4", Export::Format::MPEG2, Output::VIDEO, false},
+		{"MPEG4", "mp4", Export::Format::MPEG4, Output::VIDEO, false},
+		{"PRORES", "mov", Export::Format::PRORES, Output::VIDEO, true}
 	#endif
 	};
 
@@ -141,94 +306,471 @@ Recorder::Recorder(){
 		#endif
 	#endif
 
-	// This implements a very basic thread pool.
-	// Each thread has its reserved data (buffer, frame, context) allocated and is the only
-	// one allowed to use them, apart from the main thread when spawning tasks.
-	// This is supposed to be safe by designed (the main thread will join the thread it want to use beforehand)
-	// but is not very flexible and requires duplication of data/contexts.
+	// The conversion program changes with the format, registered uniforms are resolved at each init.
+	ShaderProgram & program = _planesPass.program();
+	_planesUniforms.plane = program.registerUniform("plane");
+	_planesUniforms.subsampling = program.registerUniform("subsampling");
+	_planesUniforms.depthScale = program.registerUniform("depthScale");
+	_planesUniforms.maxValue = program.registerUniform("maxValue");
+	_planesUniforms.opaque = program.registerUniform("opaque");
+	_planesUniforms.unpremultiply = program.registerUniform("unpremultiply");
+
+	// Frames are converted and written by persistent workers.
+	// Each job owns one of the saving buffers (or its video frame) until it completes,
+	// then gives it back to the free list. When no buffer is free, recording waits for a job to complete.
 	int numThreads = std::thread::hardware_concurrency();
-	int poolSize = glm::clamp(numThreads - 1, 2, 8);
-	_savingBuffers.resize(poolSize);
-	_savingThreads.resize(poolSize);
-	_frames.resize(poolSize, nullptr);
-	_swsContexts.resize(poolSize, nullptr);
+	_workersCount = glm::clamp(numThreads - 1, 2, 8);
+	const size_t buffersCount = 2 * _workersCount;
+	_savingBuffers.resize(buffersCount);
+	_frames.resize(buffersCount, nullptr);
+	// Frames are read back asynchronously, and only mapped a few frames later.
+	_readbacks.resize(3);
 }
 
 Recorder::~Recorder(){
-
+	// Don't leave the encoder thread running if an export was interrupted.
+	if(_writer.joinable()){
+		_workers.wait();
+		{
+			std::lock_guard<std::mutex> lock(_writerMutex);
+			_stopWriter = true;
+		}
+		_frameReady.notify_one();
+		_writer.join();
+	}
 }
 
 void Recorder::record(const std::shared_ptr<Framebuffer> & frame){
+	TRACE_SCOPE("Recorder::record");
 
 	const unsigned int displayCurrentFrame = _currentFrame + 1;
 	if((displayCurrentFrame == 1) || (displayCurrentFrame % 10 == 0)){
 		std::cout << "\r[EXPORT]: Processing frame " << displayCurrentFrame << "/" << _framesCount << "." << std::flush;
 	}
 
-	// Make sure rendering is complete.
-	glFinish();
-	glFlush();
-
 	if(frame->_width != _size[0] || frame->_height != _size[1]){
 		std::cout << std::endl;
 		std::cerr << "[EXPORT]: Unexpected frame size while recording, at frame " << displayCurrentFrame << ". Stopping." << std::endl;
 		_currentFrame = _framesCount;
+		finish();
+		return;
+	}
+
+	if(_outputFailed){
+		std::cout << std::endl;
+		std::cerr << "[EXPORT]: Output stream closed, at frame " << displayCurrentFrame << ". Stopping." << std::endl;
+		_currentFrame = _framesCount;
+		finish();
 		return;
 	}
 
-	const unsigned int buffIndex = _currentFrame % _savingThreads.size();
-	// Make sure the thread we want to work on is available.
-	if(_savingThreads[buffIndex].joinable())
-		_savingThreads[buffIndex].join();
+	// Queue an asynchronous readback, the GPU will copy the frame once it is rendered.
+	{
+		TRACE_SCOPE("Readback");
+		Readback & readback = _readbacks[_currentFrame % _readbacks.size()];
+		readbackPlanes(frame, readback.buffer);
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
 
-	// Readback.
-	frame->bind();
-	glReadPixels(0, 0, (GLsizei)_size[0], (GLsizei)_size[1], GL_RGBA, GL_UNSIGNED_BYTE, _savingBuffers[buffIndex].data());
-	frame->unbind();
+	// Save the oldest frame once all readbacks are in flight, or all remaining ones at the end.
+	const bool lastFrame = _currentFrame + 1 == _framesCount;
+	while(_savedFrames <= _currentFrame && (lastFrame || (_currentFrame + 1 - _savedFrames) >= _readbacks.size())){
+		saveFrame(_savedFrames);
+		++_savedFrames;
+	}
 
-	if(_config.format == Export::Format::PNG){
-		// Write to disk.
-		std::string intString = std::to_string(_currentFrame);
-		while (intString.size() < std::ceil(std::log10(float(_framesCount)))) {
-			intString = "0" + intString;
+	// Flush log.
+	if(lastFrame){
+		finish();
+		// Log result timing.
+		const auto endTime	 = std::chrono::high_resolution_clock::now();
+		const long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - _startTime).count();
+		const float seconds = float(duration) / 1000.0f;
+		std::cout << std::endl;
+		std::cout << "[EXPORT]: Export took " << seconds << "s (" << (float(_framesCount) / (std::max)(seconds, 0.001f)) << " frames/s)." << std::endl;
+		const WorkerPool::Stats stats = _workers.stats();
+		std::cout << "[EXPORT]: " << _workers.workers() << " workers, at most " << stats.maxQueued << " queued frames, ";
+		std::cout << "waited " << _stalls << " times for a worker (" << _stallTime << "s)." << std::endl;
+		{
+			std::lock_guard<std::mutex> lock(_statsMutex);
+			_formatStats[_config.format].exportTime += double(seconds);
 		}
-		const std::string outputFilePath = _config.path + "/output_" + intString + ".png";
-		// Move the conversion and writing to a background thread.
-		_savingThreads[buffIndex] = std::thread(writePNGToPath, &_savingBuffers[buffIndex], _size,  _config.alphaBackground, _config.fixPremultiply, outputFilePath);
+		logFormatStats();
+	}
+
+	++_currentFrame;
+	_currentTime = frameTime(_firstFrame + _currentFrame);
+}
+
+void Recorder::saveFrame(size_t frameId){
+	Readback & readback = _readbacks[frameId % _readbacks.size()];
+	// Make sure the readback is complete.
+	{
+		TRACE_SCOPE("Wait for GPU");
+		GLenum status = GL_TIMEOUT_EXPIRED;
+		while(status == GL_TIMEOUT_EXPIRED){
+			status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		if(status == GL_WAIT_FAILED){
+			std::cerr << "[EXPORT]: Unable to wait for frame " << (frameId + 1) << " readback." << std::endl;
+		}
+		glDeleteSync(readback.fence);
+		readback.fence = nullptr;
+	}
+
+	const size_t buffIndex = acquireBuffer();
+
+	// Copy the frame out of the pixel buffer.
+	{
+		TRACE_SCOPE("Map readback");
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		const GLubyte * data = (const GLubyte *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, _readbackSize, GL_MAP_READ_BIT);
+		if(data){
+			if(currentFormat().output != Output::VIDEO){
+				std::copy(data, data + _readbackSize, _savingBuffers[buffIndex].begin());
+			} else {
+#ifdef MIDIVIZ_SUPPORT_VIDEO
+				// Planes are already in the codec layout, fill the frame directly.
+				AVFrame * videoFrame = _frames[buffIndex];
+				// The encoder might still reference the frame data from a previous use.
+				if(av_frame_make_writable(videoFrame) < 0){
+					std::cerr << "[VIDEO]: Unable to write to frame " << (frameId + 1) << "." << std::endl;
+				} else {
+					for(size_t pid = 0; pid < _planes.size(); ++pid){
+						const Plane & plane = _planes[pid];
+						for(int y = 0; y < plane.target->_height; ++y){
+							std::memcpy(videoFrame->data[pid] + y * videoFrame->linesize[pid], data + plane.offset + y * plane.rowSize, plane.rowSize);
+						}
+					}
+				}
+#endif
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		} else {
+			std::cerr << "[EXPORT]: Unable to read frame " << (frameId + 1) << "." << std::endl;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	const CodecOpts & format = currentFormat();
+	if(format.output == Output::IMAGES){
+		// Write to disk, numbered in the whole export.
+		const std::string outputFilePath = imagePath(_firstFrame + frameId);
+		// Move the compression and writing to a worker.
+		const glm::ivec2 size = _size;
+		const size_t channels = imageChannels();
+		const Export::Format imageFormat = format.format;
+		const int compression = _config.compression;
+		_workers.push([this, buffIndex, size, channels, imageFormat, compression, outputFilePath](){
+			const auto start = std::chrono::steady_clock::now();
+			const size_t written = writeImageToPath(&_savingBuffers[buffIndex], size, channels, imageFormat, compression, outputFilePath);
+			const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			releaseBuffer(buffIndex);
+			std::lock_guard<std::mutex> lock(_statsMutex);
+			FormatStats & stats = _formatStats[imageFormat];
+			++stats.frames;
+			stats.bytes += written;
+			stats.encodeTime += duration;
+		});
 
 	} else {
-		// This will do nothing (and is unreachable) if the video module is not present.
 #ifdef MIDIVIZ_SUPPORT_VIDEO
-		_frames[buffIndex]->pts = _currentFrame;
-		// This could be multithreaded similarly to the PNG case, but the ffmepg flush needs to be threadsafe.
-#ifdef FFMPEG_USE_THREADS
-		_savingThreads[buffIndex] = std::thread(writeFrameToVideo, &_savingBuffers[buffIndex], _size,  _config.alphaBackground, _config.fixPremultiply, _frames[buffIndex], _swsContexts[buffIndex], _codecCtx, this);
-#else
-		writeFrameToVideo( &_savingBuffers[buffIndex], _size, _config.alphaBackground, _config.fixPremultiply, _frames[buffIndex], _swsContexts[buffIndex], _codecCtx, this);
+		if(format.output == Output::VIDEO){
+			_frames[buffIndex]->pts = frameId;
+		}
 #endif
+		// Hand the frame to the writer thread that will send it in order.
+		{
+			std::lock_guard<std::mutex> lock(_writerMutex);
+			_readyFrames[frameId] = buffIndex;
+		}
+		_frameReady.notify_one();
+	}
+}
+
+void Recorder::writeFrames(){
+	const bool stream = currentFormat().output == Output::STREAM;
+	TRACE_THREAD(stream ? "Stream writer" : "Encoder");
+	size_t nextFrame = 0;
+	while(true){
+		size_t buffIndex = 0;
+		{
+			// Frames can be converted out of order, wait for the next one.
+			std::unique_lock<std::mutex> lock(_writerMutex);
+			_frameReady.wait(lock, [this, nextFrame](){
+				return _stopWriter || _readyFrames.count(nextFrame) != 0;
+			});
+			const auto next = _readyFrames.find(nextFrame);
+			if(next == _readyFrames.end()){
+				// Stopping, all converted frames have been sent.
+				return;
+			}
+			buffIndex = next->second;
+			_readyFrames.erase(next);
+		}
+		const auto start = std::chrono::steady_clock::now();
+		size_t written = 0;
+		if(stream){
+			// Blocks when the consumer is slower, and the renderer will wait for the buffer.
+			TRACE_SCOPE("Write frame");
+			const std::vector<GLubyte> & buffer = _savingBuffers[buffIndex];
+			if(!_outputFailed){
+				bool success = true;
+				if(_config.format == Export::Format::Y4M){
+					success = fputs("FRAME\n", _output) >= 0;
+					written += 6;
+				}
+				success = success && fwrite(buffer.data(), 1, buffer.size(), _output) == buffer.size();
+				written += buffer.size();
+				if(!success){
+					_outputFailed = true;
+				}
+			}
+		} else {
+#ifdef MIDIVIZ_SUPPORT_VIDEO
+			TRACE_SCOPE("Encode frame");
+			AVFrame * frame = _frames[buffIndex];
+			const int res = avcodec_send_frame(_codecCtx, frame);
+			if(res == AVERROR(EAGAIN)){
+				// Unavailable right now, should flush and retry.
+				if(flush()){
+					avcodec_send_frame(_codecCtx, frame);
+				}
+			} else if(res < 0){
+				std::cerr << "[VIDEO]: Unable to send frame " << (frame->pts + 1) << "." << std::endl;
+			}
 #endif
+		}
+		const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		releaseBuffer(buffIndex);
+		{
+			std::lock_guard<std::mutex> lock(_statsMutex);
+			FormatStats & stats = _formatStats[_config.format];
+			++stats.frames;
+			stats.bytes += written;
+			stats.encodeTime += duration;
+		}
+		++nextFrame;
 	}
+}
 
-	// Flush log.
-	if(_currentFrame + 1 == _framesCount){
-		// Wait for all export tasks to finish.
-		for(auto& thread : _savingThreads){
-			if(thread.joinable())
-				thread.join();
-		}
-		// End the video stream if needed.
-		if(_config.format != Export::Format::PNG){
+void Recorder::finish(){
+	// Wait for all export tasks to finish.
+	TRACE_SCOPE("Finish export");
+	_workers.wait();
+	releaseReadbacks();
+	releasePlanes();
+	// End the video stream if needed.
+	if(_writer.joinable()){
+		{
+			std::lock_guard<std::mutex> lock(_writerMutex);
+			_stopWriter = true;
+		}
+		_frameReady.notify_one();
+		_writer.join();
+		if(currentFormat().output == Output::STREAM){
+			closeStream();
+		} else {
 			endVideo();
 		}
-		// Log result timing.
-		const auto endTime	 = std::chrono::high_resolution_clock::now();
-		const long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - _startTime).count();
-		std::cout << std::endl;
-		std::cout << "[EXPORT]: Export took " << (float(duration) / 1000.0f) << "s." << std::endl;
 	}
+}
 
-	_currentTime += (1.0f / float(_config.framerate));
-	++_currentFrame;
+bool Recorder::openStream(){
+	_outputFailed = false;
+	if(_config.path == "-"){
+		if(!_standardOutput){
+			std::cerr << "[EXPORT]: The standard output is not available for streaming." << std::endl;
+			return false;
+		}
+		_output = _standardOutput;
+	} else {
+		// Opening a named pipe waits for a reader.
+		_output = fopen(_config.path.c_str(), "wb");
+		if(!_output){
+			std::cerr << "[EXPORT]: Unable to open " << _config.path << " for streaming." << std::endl;
+			return false;
+		}
+	}
+#ifndef _WIN32
+	// Report a closed pipe as a write error instead of terminating.
+	signal(SIGPIPE, SIG_IGN);
+#endif
+	if(_config.format == Export::Format::Y4M){
+		// 4:2:0 with chroma samples centered between pixels, as produced by the planes shader.
+		const std::string header = "YUV4MPEG2 W" + std::to_string(_size[0]) + " H" + std::to_string(_size[1]) + " F" + std::to_string(_config.framerate) + ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+		if(fputs(header.c_str(), _output) < 0){
+			_outputFailed = true;
+		}
+	}
+	return true;
+}
+
+void Recorder::closeStream(){
+	if(!_output){
+		return;
+	}
+	if(fflush(_output) != 0){
+		_outputFailed = true;
+	}
+	if(_output != _standardOutput){
+		fclose(_output);
+	}
+	_output = nullptr;
+	if(_outputFailed){
+		std::cerr << "[EXPORT]: Some frames could not be written to the output stream." << std::endl;
+	}
+}
+
+size_t Recorder::acquireBuffer(){
+	std::unique_lock<std::mutex> lock(_buffersMutex);
+	if(_freeBuffers.empty()){
+		// Backpressure: all buffers are queued or being written.
+		TRACE_SCOPE("Wait for worker");
+		const auto start = std::chrono::steady_clock::now();
+		_bufferReleased.wait(lock, [this](){ return !_freeBuffers.empty(); });
+		++_stalls;
+		_stallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	const size_t buffIndex = _freeBuffers.back();
+	_freeBuffers.pop_back();
+	return buffIndex;
+}
+
+void Recorder::releaseBuffer(size_t buffIndex){
+	{
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		_freeBuffers.push_back(buffIndex);
+	}
+	_bufferReleased.notify_one();
+}
+
+bool Recorder::createPlanes(){
+	releasePlanes();
+	_readbackSize = 0;
+
+	if(currentFormat().output == Output::IMAGES || _config.format == Export::Format::RAW){
+		// A single plane with the final image, in the layout of the format.
+		const size_t channels = imageChannels();
+		Plane plane;
+		plane.target = std::shared_ptr<Framebuffer>(new Framebuffer(_size[0], _size[1], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST, GL_CLAMP_TO_EDGE));
+		plane.rowSize = size_t(_size[0]) * channels;
+		_readbackSize = plane.rowSize * size_t(_size[1]);
+		_planes.push_back(plane);
+		if(_config.format == Export::Format::TGA){
+			_planesFormat = channels == 4 ? GL_BGRA : GL_BGR;
+		} else {
+			_planesFormat = channels == 4 ? GL_RGBA : GL_RGB;
+		}
+		_planesType = GL_UNSIGNED_BYTE;
+		_planesPass.init("exportrgba_frag");
+		return true;
+	}
+
+	// Planar YUV, 4:2:0 for streams or the codec pixel format.
+	int components = 3;
+	glm::ivec2 chromaShift(1, 1);
+	int depth = 8;
+	if(currentFormat().output == Output::VIDEO){
+#ifdef MIDIVIZ_SUPPORT_VIDEO
+		const AVPixFmtDescriptor * desc = av_pix_fmt_desc_get(_codecCtx->pix_fmt);
+		if(!desc || !(desc->flags & AV_PIX_FMT_FLAG_PLANAR) || (desc->flags & AV_PIX_FMT_FLAG_RGB)){
+			std::cerr << "[VIDEO]: Unsupported pixel format for conversion." << std::endl;
+			return false;
+		}
+		components = desc->nb_components;
+		chromaShift = glm::ivec2(desc->log2_chroma_w, desc->log2_chroma_h);
+		depth = desc->comp[0].depth;
+#else
+		return false;
+#endif
+	}
+	// Values above 8 bits are stored in 16 bits, as the frame data.
+	const bool wide = depth > 8;
+	_planesFormat = GL_RED;
+	_planesType = wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+	_planesDepthScale = float(1 << (depth - 8));
+	const size_t texelSize = wide ? 2 : 1;
+
+	// Luma, chroma and optional alpha, each in its own plane.
+	for(int cid = 0; cid < components; ++cid){
+		Plane plane;
+		if(cid == 1 || cid == 2){
+			plane.subsampling = glm::ivec2(1 << chromaShift[0], 1 << chromaShift[1]);
+		}
+		const glm::ivec2 planeSize = _size / plane.subsampling;
+		plane.target = std::shared_ptr<Framebuffer>(new Framebuffer(planeSize[0], planeSize[1], wide ? GL_R16 : GL_R8, GL_RED, _planesType, GL_NEAREST, GL_CLAMP_TO_EDGE));
+		plane.offset = _readbackSize;
+		plane.rowSize = size_t(planeSize[0]) * texelSize;
+		_readbackSize += plane.rowSize * size_t(planeSize[1]);
+		_planes.push_back(plane);
+	}
+	_planesPass.init("exportplanes_frag");
+	return true;
+}
+
+void Recorder::releasePlanes(){
+	if(_planes.empty()){
+		return;
+	}
+	_planes.clear();
+	_planesPass.clean();
+}
+
+void Recorder::readbackPlanes(const std::shared_ptr<Framebuffer> & frame, GLuint buffer){
+	TRACE_SCOPE("Convert planes");
+	GLState::apply(GLState::Setup(GLState::Blend::NONE, false));
+	// Rows are tightly packed, restore the previous alignment afterwards.
+	GLint packAlignment = 1;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	ShaderProgram & program = _planesPass.program();
+	program.use();
+	program.uniform(_planesUniforms.depthScale, _planesDepthScale);
+	program.uniform(_planesUniforms.maxValue, _planesType == GL_UNSIGNED_SHORT ? 65535.0f : 255.0f);
+	program.uniform(_planesUniforms.opaque, !_config.alphaBackground);
+	program.uniform(_planesUniforms.unpremultiply, _config.alphaBackground && _config.fixPremultiply);
+
+	for(size_t pid = 0; pid < _planes.size(); ++pid){
+		const Plane & plane = _planes[pid];
+		plane.target->bind();
+		glViewport(0, 0, plane.target->_width, plane.target->_height);
+		program.use();
+		program.uniform(_planesUniforms.plane, int(pid));
+		program.uniform(_planesUniforms.subsampling, glm::vec2(plane.subsampling));
+		_planesPass.draw(frame->textureId(), 0.0f);
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glReadPixels(0, 0, plane.target->_width, plane.target->_height, _planesFormat, _planesType, (void*)plane.offset);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		plane.target->unbind();
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+}
+
+void Recorder::createReadbacks(){
+	releaseReadbacks();
+	for(Readback & readback : _readbacks){
+		glGenBuffers(1, &readback.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, _readbackSize, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_savedFrames = 0;
+}
+
+void Recorder::releaseReadbacks(){
+	for(Readback & readback : _readbacks){
+		if(readback.fence){
+			glDeleteSync(readback.fence);
+			readback.fence = nullptr;
+		}
+		if(readback.buffer){
+			glDeleteBuffers(1, &readback.buffer);
+			readback.buffer = 0;
+		}
+	}
 }
 
 bool Recorder::drawGUI(float scale){
@@ -240,7 +782,7 @@ bool Recorder::drawGUI(float scale){
 		const float scaledColumn = scale * EXPORT_COLUMN_SIZE;
 
 		// Dropdown list.
-		if(ImGui::BeginCombo("Format", _formats[int(_config.format)].name.c_str())){
+		if(ImGui::BeginCombo("Format", currentFormat().name.c_str())){
 			for(size_t i = 0; i < _formats.size(); ++i){
 				ImGui::PushID((void*)(intptr_t)i);
 
@@ -270,19 +812,25 @@ bool Recorder::drawGUI(float scale){
 
 		ImGui::InputFloat("Postroll", &_config.postroll, 0.1f, 1.0f, "%.1fs");
 
+		const CodecOpts & format = currentFormat();
 		bool lineStarted = false;
-		if(_config.format == Export::Format::PNG || _config.format == Export::Format::PRORES){
+		if(format.alpha){
 			ImGui::Checkbox("Transparent bg.", &_config.alphaBackground);
 			lineStarted = true;
 		}
 
-		if(_config.format != Export::Format::PNG){
+		if(format.output == Output::VIDEO){
 			if(lineStarted){
 				ImGui::SameLine(scaledColumn);
 			}
 			ImGui::InputInt("Rate (Mbps)", &_config.bitrate);
+		} else if(_config.format == Export::Format::PNG){
+			if(lineStarted){
+				ImGui::SameLine(scaledColumn);
+			}
+			ImGui::SliderInt("Compression", &_config.compression, 0, 9);
 		}
-		if((_config.format == Export::Format::PNG || _config.format == Export::Format::PRORES) && _config.alphaBackground){
+		if(format.alpha && _config.alphaBackground){
 			ImGui::Checkbox("Fix premultiply", &_config.fixPremultiply);
 		}
 
@@ -296,14 +844,14 @@ bool Recorder::drawGUI(float scale){
 		}
 		
 		ImGui::SameLine(scaledColumn);
-		const std::string exportType = _config.format == Export::Format::PNG ? "images" : "video";
+		const std::string exportType = format.output == Output::IMAGES ? "images" : (format.output == Output::STREAM ? "stream" : "video");
 		const std::string exportButtonName = "Save " + exportType + " to...";
 
 		if (ImGui::Button(exportButtonName.c_str(), buttonSize)) {
 			// Read arguments.
 			nfdchar_t *outPath = NULL;
 
-			if(_config.format == Export::Format::PNG){
+			if(format.output == Output::IMAGES){
 				nfdresult_t result = NFD_PickFolder(NULL, &outPath);
 				if(result == NFD_OKAY) {
 					_config.path = std::string(outPath);
@@ -311,7 +859,7 @@ bool Recorder::drawGUI(float scale){
 					ImGui::CloseCurrentPopup();
 				}
 			} else {
-				const std::string & ext = _formats.at(int(_config.format)).ext;
+				const std::string & ext = format.ext;
 				nfdresult_t result = NFD_SaveDialog(ext.c_str(), NULL, &outPath);
 				if(result == NFD_OKAY) {
 					_config.path = std::string(outPath);
@@ -333,28 +881,81 @@ bool Recorder::drawGUI(float scale){
 }
 
 void Recorder::prepare(float preroll, float duration, float speed){
-	_currentTime = -preroll;
-	_framesCount = int(std::ceil((duration + _config.postroll + preroll) * _config.framerate / speed));
+	_preroll = preroll;
+	_totalFrames = int(std::ceil((duration + _config.postroll + preroll) * _config.framerate / speed));
+	// Segments sharing a bound are rounded the same way, so that they partition the export.
+	const float framerate = float(_config.framerate);
+	_firstFrame = (std::min)(size_t(std::round(_config.rangeStart * framerate)), _totalFrames);
+	size_t lastFrame = _totalFrames;
+	if(_config.rangeEnd >= 0.0f){
+		lastFrame = glm::clamp(size_t(std::round(_config.rangeEnd * framerate)), _firstFrame, _totalFrames);
+	}
+	_framesCount = lastFrame - _firstFrame;
 	_currentFrame = _framesCount;
+	_currentTime = frameTime(_firstFrame);
 	_sceneDuration = duration;
-	// Image writing setup.
-	const size_t dataSize = _size[0] * _size[1] * 4;
-	for(unsigned int i = 0; i < _savingBuffers.size(); ++i){
-		_savingBuffers[i].resize(dataSize);
-	}
 }
 
 void Recorder::start(bool verbose) {
+	if(_framesCount == 0){
+		std::cerr << "[EXPORT]: No frame to export in the requested range." << std::endl;
+		return;
+	}
+	if(_framesCount == 1 && _totalFrames > 1){
+		std::cerr << "[EXPORT]: The requested range only covers frame " << _firstFrame << ", check its bounds." << std::endl;
+	}
 	_currentFrame = 0;
 
-	if (_config.format != Export::Format::PNG) {
-		initVideo(_config.path, _config.format, verbose);
+	const Output output = currentFormat().output;
+	if (output == Output::VIDEO) {
+		if(!initVideo(_config.path, _config.format, verbose)){
+			std::cerr << "[EXPORT]: Unable to start video export." << std::endl;
+			_currentFrame = _framesCount;
+			return;
+		}
+		// Only the planes of the codec layout are read back.
+		if(!createPlanes()){
+			endVideo();
+			_currentFrame = _framesCount;
+			return;
+		}
+	} else if(output == Output::STREAM){
+		if(!openStream()){
+			_currentFrame = _framesCount;
+			return;
+		}
+		createPlanes();
+	} else {
+		createPlanes();
+		resumeImages();
+	}
+	// Image and stream writing setup, video frames are directly filled from the readback.
+	const size_t dataSize = output == Output::VIDEO ? 0 : _readbackSize;
+	for(unsigned int i = 0; i < _savingBuffers.size(); ++i){
+		_savingBuffers[i].resize(dataSize);
+	}
+	if(output != Output::IMAGES){
+		// Frames are sent to the encoder or the stream from a single thread, in order.
+		_stopWriter = false;
+		_readyFrames.clear();
+		_writer = std::thread(&Recorder::writeFrames, this);
 	}
 	_startTime = std::chrono::high_resolution_clock::now();
-
-	for(unsigned int i = 0; i < _savingThreads.size(); ++i){
-		_savingThreads[i] = std::thread();
+	createReadbacks();
+
+	// Workers are kept between exports.
+	_workers.start(_workersCount, _savingBuffers.size(), "Export worker");
+	_workers.wait();
+	_workers.resetStats();
+	{
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		_freeBuffers.clear();
+		for(size_t bid = 0; bid < _savingBuffers.size(); ++bid){
+			_freeBuffers.push_back(bid);
+		}
 	}
+	_stalls = 0;
+	_stallTime = 0.0;
 }
 
 void Recorder::drawProgress(){
@@ -371,6 +972,11 @@ void Recorder::drawProgress(){
 
 		const std::string currProg = std::to_string(_currentFrame + 1) + "/" + std::to_string(_framesCount);
 		ImGui::ProgressBar(float(_currentFrame + 1) / float(_framesCount), ImVec2(-1.0f, 0.0f), currProg.c_str());
+
+		// Help balancing the workers count against the disk and CPU.
+		const WorkerPool::Stats stats = _workers.stats();
+		ImGui::Text("Workers: %zu, queued frames: %zu (max %zu)", _workers.workers(), stats.queued, stats.maxQueued);
+		ImGui::Text("Waited for a worker: %zu times (%.2fs)", _stalls, _stallTime);
 		ImGui::EndPopup();
 	}
 }
@@ -395,10 +1001,29 @@ size_t Recorder::framesCount() const {
 	return _framesCount;
 }
 
+size_t Recorder::firstFrame() const {
+	return _firstFrame;
+}
+
+float Recorder::frameTime(long long frame) const {
+	// Computed from the frame index so that all segments agree on the time of a frame.
+	return -_preroll + float(frame) / float(_config.framerate);
+}
+
+int Recorder::framerate() const {
+	return _config.framerate;
+}
+
 const glm::ivec2 & Recorder::requiredSize() const {
 	return _size;
 }
 
+void Recorder::setSources(const std::string & settings, const std::string & midi){
+	_canResume = !midi.empty();
+	_settingsHash = System::hash(settings);
+	_midiHash = System::hash(midi);
+}
+
 void Recorder::setSize(const glm::ivec2 & size){
 	_size = size;
 	_size[0] += _size[0]%2;
@@ -407,16 +1032,19 @@ void Recorder::setSize(const glm::ivec2 & size){
 
 bool Recorder::setParameters(const Export& exporting){
 	// Check if the format is supported.
-	if(int(exporting.format) >= _formats.size()){
+	const auto format = std::find_if(_formats.begin(), _formats.end(), [&exporting](const CodecOpts & opts){
+		return opts.format == exporting.format;
+	});
+	if(format == _formats.end()){
 		std::cerr << "[EXPORT]: The requested output format is not supported by this executable. If this is a video format, make sure MIDIVisualizer has been compiled with ffmpeg enabled by checking the output of ./MIDIVisualizer --version" << std::endl;
 		return false;
 	}
 	_config = exporting;
 	
 
-	if(_config.format != Export::Format::PNG){
+	if(format->output == Output::VIDEO){
 		// Check that the export path is valid.
-		const std::string & ext = _formats.at(int(_config.format)).ext;
+		const std::string & ext = format->ext;
 		const std::string fullExt = "." + ext;
 		// Append extension if needed.
 		if(_config.path.size() < 5 || (_config.path.substr(_config.path.size()-4) != fullExt)){
@@ -426,6 +1054,291 @@ bool Recorder::setParameters(const Export& exporting){
 	return true;
 }
 
+std::string Recorder::imagePath(size_t frame) const {
+	std::string intString = std::to_string(frame);
+	while (intString.size() < std::ceil(std::log10(float(_totalFrames)))) {
+		intString = "0" + intString;
+	}
+	return _config.path + "/output_" + intString + "." + currentFormat().ext;
+}
+
+std::string Recorder::manifestContent() const {
+	// Output options changing the pixels are part of the settings.
+	uint64_t settingsHash = System::hash(currentFormat().name, _settingsHash);
+	settingsHash = System::hash(std::to_string(int(_config.alphaBackground)) + std::to_string(int(_config.fixPremultiply)), settingsHash);
+
+	std::stringstream manifest;
+	manifest << "# MIDIVisualizer export manifest, used to resume an interrupted export (do not modify)." << std::endl;
+	manifest << "version " << MIDIVIZ_VERSION_MAJOR << " " << MIDIVIZ_VERSION_MINOR << std::endl;
+	manifest << std::hex << std::setfill('0');
+	manifest << "settings " << std::setw(16) << settingsHash << std::endl;
+	manifest << "midi " << std::setw(16) << _midiHash << std::endl;
+	manifest << std::dec;
+	manifest << "format " << currentFormat().name << std::endl;
+	manifest << "framerate " << _config.framerate << std::endl;
+	manifest << "size " << _size[0] << " " << _size[1] << std::endl;
+	manifest << "frames " << _totalFrames << std::endl;
+	manifest << "range " << _firstFrame << " " << (_firstFrame + _framesCount) << std::endl;
+	return manifest.str();
+}
+
+void Recorder::resumeImages(){
+	// Each range has its own manifest, so that segments exported concurrently in the same directory do not interfere.
+	const std::string manifestPath = _config.path + "/manifest_" + std::to_string(_firstFrame) + "_" + std::to_string(_firstFrame + _framesCount) + ".txt";
+	if(!_canResume){
+		// Images of a previous export will be replaced.
+		std::remove(manifestPath.c_str());
+		return;
+	}
+	const std::string manifest = manifestContent();
+	if(System::loadStringFromFile(manifestPath) != manifest){
+		// Images left by a different export could be mistaken for frames of this one if it is interrupted.
+		// They are all removed before the manifest is published, the previous one does not match if this is interrupted.
+		for(size_t fid = _firstFrame; fid < _firstFrame + _framesCount; ++fid){
+			std::remove(imagePath(fid).c_str());
+		}
+		const std::string tempPath = manifestPath + ".part";
+		std::ofstream manifestFile = System::openOutputFile(tempPath);
+		if(!manifestFile.is_open()){
+			std::cerr << "[EXPORT]: Unable to write the export manifest, the export will not be resumable." << std::endl;
+			return;
+		}
+		manifestFile << manifest;
+		manifestFile.close();
+		moveToPath(tempPath, manifestPath);
+		return;
+	}
+
+	// Skip the frames already written, the last one is always exported again to complete the export as usual.
+	const Export::Format format = currentFormat().format;
+	const size_t channels = imageChannels();
+	size_t resumeFrame = 0;
+	while(resumeFrame + 1 < _framesCount && isImageComplete(imagePath(_firstFrame + resumeFrame), format, _size, channels)){
+		++resumeFrame;
+	}
+	if(resumeFrame == 0){
+		return;
+	}
+	std::cout << "[EXPORT]: Resuming at frame " << (_firstFrame + resumeFrame) << ", " << resumeFrame << " frames already exported." << std::endl;
+	_firstFrame += resumeFrame;
+	_framesCount -= resumeFrame;
+	_currentTime = frameTime(_firstFrame);
+}
+
+const Recorder::CodecOpts & Recorder::currentFormat() const {
+	for(const CodecOpts & opts : _formats){
+		if(opts.format == _config.format){
+			return opts;
+		}
+	}
+	return _formats[0];
+}
+
+size_t Recorder::imageChannels() const {
+	// Raw streams are always RGBA, for a fixed layout.
+	if(_config.format == Export::Format::RAW){
+		return 4;
+	}
+	return (currentFormat().alpha && _config.alphaBackground) ? 4 : 3;
+}
+
+void Recorder::logFormatStats() const {
+	std::cout << "[EXPORT]: Format   Frames   MB/frame   Encode ms/frame   Frames/s   MB/s" << std::endl;
+	for(const CodecOpts & opts : _formats){
+		const auto stats = _formatStats.find(opts.format);
+		if(stats == _formatStats.end() || stats->second.frames == 0){
+			continue;
+		}
+		const FormatStats & st = stats->second;
+		const double frames = double(st.frames);
+		const double megabytes = double(st.bytes) / (1024.0 * 1024.0);
+		const double exportTime = (std::max)(st.exportTime, 0.001);
+		std::cout << "[EXPORT]: " << std::left << std::setw(9) << opts.name << std::right << std::fixed << std::setprecision(2);
+		std::cout << std::setw(6) << st.frames << std::setw(11) << (megabytes / frames);
+		std::cout << std::setw(18) << (1000.0 * st.encodeTime / frames) << std::setw(11) << (frames / exportTime);
+		std::cout << std::setw(7) << (megabytes / exportTime) << std::defaultfloat << std::endl;
+	}
+}
+
+void Recorder::reserveStandardOutput(){
+	if(_standardOutput){
+		return;
+	}
+	std::cout << std::flush;
+	fflush(stdout);
+#ifdef _WIN32
+	const int output = _dup(_fileno(stdout));
+	if(output < 0 || _dup2(_fileno(stderr), _fileno(stdout)) < 0){
+		std::cerr << "[EXPORT]: Unable to reserve the standard output." << std::endl;
+		return;
+	}
+	_setmode(output, _O_BINARY);
+	_standardOutput = _fdopen(output, "wb");
+#else
+	const int output = dup(fileno(stdout));
+	if(output < 0 || dup2(fileno(stderr), fileno(stdout)) < 0){
+		std::cerr << "[EXPORT]: Unable to reserve the standard output." << std::endl;
+		return;
+	}
+	_standardOutput = fdopen(output, "wb");
+#endif
+}
+
+#ifdef MIDIVIZ_SUPPORT_VIDEO
+
+/// Remux encoded segments one after the other, without decoding them.
+static bool concatenateVideos(const std::vector<std::string> & segments, const std::string & path){
+	AVFormatContext * outCtx = nullptr;
+	if(avformat_alloc_output_context2(&outCtx, nullptr, nullptr, path.c_str()) < 0 || !outCtx){
+		std::cerr << "[VIDEO]: Unable to create format context for " << path << "." << std::endl;
+		return false;
+	}
+	AVStream * outStream = nullptr;
+	// Timestamps of each segment are shifted after the end of the previous one.
+	int64_t offset = 0;
+	bool success = true;
+	for(const std::string & segment : segments){
+		AVFormatContext * inCtx = nullptr;
+		if(avformat_open_input(&inCtx, segment.c_str(), nullptr, nullptr) < 0){
+			std::cerr << "[VIDEO]: Unable to open " << segment << "." << std::endl;
+			success = false;
+			break;
+		}
+		const int streamId = avformat_find_stream_info(inCtx, nullptr) < 0 ? -1 : av_find_best_stream(inCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+		if(streamId < 0){
+			std::cerr << "[VIDEO]: No video stream in " << segment << "." << std::endl;
+			avformat_close_input(&inCtx);
+			success = false;
+			break;
+		}
+		AVStream * inStream = inCtx->streams[streamId];
+
+		if(!outStream){
+			// Segments are encoded with the same settings, the first one describes the output.
+			outStream = avformat_new_stream(outCtx, nullptr);
+			if(!outStream || avcodec_parameters_copy(outStream->codecpar, inStream->codecpar) < 0){
+				std::cerr << "[VIDEO]: Unable to create output stream." << std::endl;
+				avformat_close_input(&inCtx);
+				success = false;
+				break;
+			}
+			outStream->codecpar->codec_tag = 0;
+			outStream->time_base = inStream->time_base;
+			if(avio_open(&outCtx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0 || avformat_write_header(outCtx, nullptr) < 0){
+				std::cerr << "[VIDEO]: Unable to open " << path << " for writing." << std::endl;
+				avformat_close_input(&inCtx);
+				success = false;
+				break;
+			}
+		}
+		// Fallback for packets without a duration.
+		const int64_t frameDuration = inStream->avg_frame_rate.num > 0 ? av_rescale_q(1, av_inv_q(inStream->avg_frame_rate), outStream->time_base) : 1;
+
+		int64_t end = offset;
+		AVPacket packet = {0};
+		av_init_packet(&packet);
+		while(success && av_read_frame(inCtx, &packet) >= 0){
+			if(packet.stream_index == streamId){
+				av_packet_rescale_ts(&packet, inStream->time_base, outStream->time_base);
+				if(packet.pts != AV_NOPTS_VALUE){
+					packet.pts += offset;
+					end = (std::max)(end, packet.pts + (packet.duration > 0 ? packet.duration : frameDuration));
+				}
+				if(packet.dts != AV_NOPTS_VALUE){
+					packet.dts += offset;
+				}
+				packet.stream_index = outStream->index;
+				packet.pos = -1;
+				if(av_interleaved_write_frame(outCtx, &packet) < 0){
+					std::cerr << "[VIDEO]: Unable to write frame to file." << std::endl;
+					success = false;
+				}
+			}
+			av_packet_unref(&packet);
+		}
+		offset = end;
+		avformat_close_input(&inCtx);
+	}
+
+	if(outCtx->pb){
+		av_write_trailer(outCtx);
+		avio_closep(&outCtx->pb);
+	}
+	avformat_free_context(outCtx);
+	return success;
+}
+
+#endif
+
+bool Recorder::concatenate(const std::vector<std::string> & segments, const std::string & path){
+	const std::string::size_type extPos = path.find_last_of('.');
+	const std::string ext = extPos == std::string::npos ? "" : path.substr(extPos + 1);
+
+	if(ext == "mp4" || ext == "mov"){
+#ifdef MIDIVIZ_SUPPORT_VIDEO
+		if(!concatenateVideos(segments, path)){
+			return false;
+		}
+		std::cout << "[EXPORT]: Joined " << segments.size() << " segments in " << path << "." << std::endl;
+		return true;
+#else
+		std::cerr << "[EXPORT]: Joining videos requires MIDIVisualizer to be compiled with ffmpeg enabled." << std::endl;
+		return false;
+#endif
+	}
+
+	// Streams are joined byte for byte, only keeping the first YUV4MPEG2 header.
+	const bool y4m = ext == "y4m";
+	FILE * output = fopen(path.c_str(), "wb");
+	if(!output){
+		std::cerr << "[EXPORT]: Unable to open " << path << " for writing." << std::endl;
+		return false;
+	}
+	std::vector<char> buffer(1 << 20);
+	std::string firstHeader;
+	bool success = true;
+	for(size_t sid = 0; sid < segments.size() && success; ++sid){
+		FILE * input = fopen(segments[sid].c_str(), "rb");
+		if(!input){
+			std::cerr << "[EXPORT]: Unable to open " << segments[sid] << "." << std::endl;
+			success = false;
+			break;
+		}
+		if(y4m){
+			std::string header;
+			int c = 0;
+			while((c = fgetc(input)) != EOF && c != '\n'){
+				header.push_back(char(c));
+			}
+			if(header.compare(0, 9, "YUV4MPEG2") != 0 || (sid > 0 && header != firstHeader)){
+				std::cerr << "[EXPORT]: " << segments[sid] << " is not a matching YUV4MPEG2 stream." << std::endl;
+				fclose(input);
+				success = false;
+				break;
+			}
+			if(sid == 0){
+				firstHeader = header;
+				success = fputs((header + "\n").c_str(), output) >= 0;
+			}
+		}
+		size_t size = 0;
+		while(success && (size = fread(buffer.data(), 1, buffer.size(), input)) > 0){
+			success = fwrite(buffer.data(), 1, size, output) == size;
+		}
+		fclose(input);
+		if(!success){
+			std::cerr << "[EXPORT]: Unable to write to " << path << "." << std::endl;
+		}
+	}
+	if(fclose(output) != 0){
+		success = false;
+	}
+	if(success){
+		std::cout << "[EXPORT]: Joined " << segments.size() << " segments in " << path << "." << std::endl;
+	}
+	return success;
+}
+
 bool Recorder::videoExportSupported(){
 #ifdef MIDIVIZ_SUPPORT_VIDEO
 	return true;
@@ -483,9 +1396,9 @@ bool Recorder::initVideo(const std::string & path, Export::Format format, bool v
 	}
 	const int tgtW = _size[0] - _size[0]%2;
 	const int tgtH = _size[1] - _size[1]%2;
-#ifdef FFMPEG_USE_THREADS
-	_codecCtx->thread_count = _savingThreads.size();
-#endif
+	// Let the encoder use its own threads too.
+	_codecCtx->thread_count = int(_workersCount);
+	_codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
 	_codecCtx->codec_id = outFormat.avid;
 	_codecCtx->width = tgtW;
 	_codecCtx->height = tgtH;
@@ -493,6 +1406,9 @@ bool Recorder::initVideo(const std::string & path, Export::Format format, bool v
 	_codecCtx->framerate = { _config.framerate, 1};
 	_codecCtx->gop_size = 10;
 	_codecCtx->pix_fmt = outFormat.avformat;
+	// Conversion conventions used by the planes shader.
+	_codecCtx->colorspace = AVCOL_SPC_SMPTE170M;
+	_codecCtx->color_range = AVCOL_RANGE_MPEG;
 	_codecCtx->bit_rate = _config.bitrate * 1000000;
 	if(_formatCtx->oformat->flags & AVFMT_GLOBALHEADER){
 		_codecCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -557,15 +1473,6 @@ bool Recorder::initVideo(const std::string & path, Export::Format format, bool v
 		return false;
 	}
 	
-	// Create scaling/conversion context.
-	for(unsigned int i = 0; i < _swsContexts.size(); ++i){
-		_swsContexts[i] = sws_getContext(_size[0], _size[1], AV_PIX_FMT_RGBA, _codecCtx->width, _codecCtx->height, _codecCtx->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
-		if(!_swsContexts[i]){
-			std::cerr << "[VIDEO]: Unable to create processing context." << std::endl;
-			return false;
-		}
-	}
-
 	// Debug log.
 	if (verbose) {
 		std::cout << "[VIDEO]: Context infos: " << std::endl;
@@ -584,16 +1491,16 @@ void Recorder::endVideo(){
 	avcodec_send_frame(_codecCtx, nullptr);
 	flush();
 	av_write_trailer(_formatCtx);
+	{
+		std::lock_guard<std::mutex> lock(_statsMutex);
+		_formatStats[_config.format].bytes += size_t((std::max)(avio_size(_formatCtx->pb), int64_t(0)));
+	}
 	avio_closep(&_formatCtx->pb);
 	avcodec_free_context(&_codecCtx);
 	for(unsigned int i = 0; i < _frames.size(); ++i){
 		av_frame_free(&_frames[i]);
 		_frames[i] = nullptr;
 	}
-	for(unsigned int i = 0; i < _swsContexts.size(); ++i){
-		sws_freeContext(_swsContexts[i]);
-		_swsContexts[i] = nullptr;
-	}
 
 	avformat_free_context(_formatCtx);
 
@@ -606,11 +1513,9 @@ void Recorder::endVideo(){
 
 bool Recorder::flush(){
 #ifdef MIDIVIZ_SUPPORT_VIDEO
-	// When multithreading, lock as we use the stream and contexts in a sequential way.
-#ifdef FFMPEG_USE_THREADS
-	const std::lock_guard<std::mutex> lock(_streamMutex);
-#endif
+	// Only called from the encoder thread, or once it is done.
 	// Keep flushing.
+	TRACE_SCOPE("Write packets");
 	while(true){
 		AVPacket packet = {0};
 		av_init_packet(&packet);
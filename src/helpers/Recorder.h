@@ -3,16 +3,20 @@
 
 #include <gl3w/gl3w.h>
 #include "../rendering/Framebuffer.h"
+#include "../rendering/ScreenQuad.h"
 #include "../helpers/Configuration.h"
+#include "../helpers/WorkerPool.h"
 #include <string>
 #include <vector>
 #include <memory>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
-
-// This is highly experimental and untested for now.
-// #define FFMPEG_USE_THREADS
+#include <map>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
 
 // Forward declare FFmpeg objects in all cases.
 struct AVFormatContext;
@@ -20,7 +24,6 @@ struct AVCodec;
 struct AVCodecContext;
 struct AVStream;
 struct AVFrame;
-struct SwsContext;
 
 class Recorder {
 
@@ -52,38 +55,165 @@ public:
 
 	size_t framesCount() const;
 
+	/// Index of the first exported frame in the whole export, when only a range is exported.
+	size_t firstFrame() const;
+
+	/// Time of a frame of the whole export, before applying the scroll speed.
+	float frameTime(long long frame) const;
+
+	int framerate() const;
+
 	const glm::ivec2 & requiredSize() const;
 
 	void setSize(const glm::ivec2 & size);
 
 	bool setParameters(const Export& exporting);
 
+	/// Identify what the exported frames depend on, to resume an interrupted image export. An empty MIDI content disables resuming.
+	void setSources(const std::string & settings, const std::string & midi);
+
 	static bool videoExportSupported();
 
+	/// Keep the standard output for streamed frames, logs printed to it will go to the standard error instead.
+	static void reserveStandardOutput();
+
+	/// Join exported segments of a video or a stream, in order, the format is deduced from the output extension.
+	static bool concatenate(const std::vector<std::string> & segments, const std::string & path);
+
 private:
 
 	bool initVideo(const std::string & path, Export::Format format, bool verbose);
 
-	bool addFrameToVideo(GLubyte * data);
+	/// Wait for the readback of a frame and hand it to a worker.
+	void saveFrame(size_t frameId);
+
+	/// Take a free saving buffer, waiting for a worker to release one if needed.
+	size_t acquireBuffer();
+
+	void releaseBuffer(size_t buffIndex);
+
+	/// Send ready frames in order to the encoder or the output stream, run on its own thread.
+	void writeFrames();
+
+	bool openStream();
+
+	void closeStream();
+
+	/// Wait for all frames to be written and close the output.
+	void finish();
+
+	/// Create the targets of the planes required by the video pixel format, or of the final image.
+	bool createPlanes();
+
+	void releasePlanes();
+
+	/// Convert the frame to the output layout and queue the readback of each plane.
+	void readbackPlanes(const std::shared_ptr<Framebuffer> & frame, GLuint buffer);
+
+	void createReadbacks();
+
+	void releaseReadbacks();
 	
 	void endVideo();
 
+	/// Path of an image, numbered in the whole export.
+	std::string imagePath(size_t frame) const;
+
+	/// Description of the export written next to the images, identical only for exports producing the same frames.
+	std::string manifestContent() const;
+
+	/// Skip the frames written by an interrupted identical export, or record the manifest of a new one.
+	void resumeImages();
+
+	/// How frames are written.
+	enum class Output {
+		IMAGES, ///< One image file per frame, in a directory.
+		VIDEO, ///< Encoded with FFmpeg.
+		STREAM ///< Uncompressed frames written to a file, a pipe or the standard output.
+	};
+
 	struct CodecOpts {
 		std::string name;
 		std::string ext;
 		Export::Format format;
+		Output output;
+		bool alpha; ///< Supports transparent backgrounds.
 	};
-	
+
+	/// Options of the current export format, which has to be supported.
+	const CodecOpts & currentFormat() const;
+
+	/// Channels of the exported images, with or without alpha.
+	size_t imageChannels() const;
+
+	/// Print the throughput of each format used in this session.
+	void logFormatStats() const;
+
 	std::vector<CodecOpts> _formats;
+
+	/// Throughput of a format over the session.
+	struct FormatStats {
+		size_t frames = 0;
+		size_t bytes = 0;
+		double encodeTime = 0.0; ///< Cumulated over workers, in seconds.
+		double exportTime = 0.0; ///< Wall time, in seconds.
+	};
+	std::map<Export::Format, FormatStats> _formatStats;
+	std::mutex _statsMutex;
+
+	/// Pixel buffer a frame is asynchronously copied to, and the fence signaled when the copy is complete.
+	struct Readback {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+	};
+	std::vector<Readback> _readbacks;
+	size_t _readbackSize = 0; ///< Bytes read back for each frame.
+
+	/// Plane of an exported frame, generated on the GPU from the rendered frame.
+	struct Plane {
+		std::shared_ptr<Framebuffer> target;
+		glm::ivec2 subsampling {1, 1}; ///< Frame pixels covered by a texel of the plane.
+		size_t offset = 0; ///< Position in the readback buffer.
+		size_t rowSize = 0; ///< In bytes.
+	};
+	std::vector<Plane> _planes; ///< Planes of the video pixel format, or a single RGB(A) plane for images.
+	ScreenQuad _planesPass;
+	/// Uniforms of the conversion updated at each frame.
+	struct PlanesUniforms {
+		ShaderProgram::Uniform plane;
+		ShaderProgram::Uniform subsampling;
+		ShaderProgram::Uniform depthScale;
+		ShaderProgram::Uniform maxValue;
+		ShaderProgram::Uniform opaque;
+		ShaderProgram::Uniform unpremultiply;
+	};
+	PlanesUniforms _planesUniforms;
+	GLenum _planesFormat = GL_RGBA;
+	GLenum _planesType = GL_UNSIGNED_BYTE;
+	float _planesDepthScale = 1.0f; ///< Scale from 8 bits to the codec bit depth.
+	size_t _savedFrames = 0; ///< Frames handed to workers, others are still being read back.
 	std::vector<std::vector<GLubyte>> _savingBuffers;
-	std::vector<std::thread> _savingThreads;
+	std::vector<size_t> _freeBuffers; ///< Saving buffers not used by a job.
+	std::mutex _buffersMutex;
+	std::condition_variable _bufferReleased;
+	size_t _stalls = 0; ///< Frames that waited for a free buffer.
+	double _stallTime = 0.0;
+	WorkerPool _workers;
+	size_t _workersCount = 2;
 
 	Export _config;
 	glm::ivec2 _size {0, 0};
-	size_t _framesCount = 0;
-	size_t _currentFrame = 0;
+	size_t _framesCount = 0; ///< Exported frames, only those of the range.
+	size_t _totalFrames = 0; ///< Frames of the whole export.
+	size_t _firstFrame = 0;
+	size_t _currentFrame = 0; ///< Relative to the first exported frame.
+	float _preroll = 0.0f;
 	float _sceneDuration = 0.0f;
 	float _currentTime = 0.0f;
+	// Sources of the exported frames.
+	uint64_t _settingsHash = 0;
+	uint64_t _midiHash = 0;
+	bool _canResume = false;
 
 	// Video context ptrs if available.
 	AVFormatContext * _formatCtx = nullptr;
@@ -91,10 +221,16 @@ private:
 	AVCodecContext * _codecCtx = nullptr;
 	AVStream * _stream = nullptr;
 	std::vector<AVFrame *> _frames;
-	std::vector<SwsContext *> _swsContexts;
-#ifdef FFMPEG_USE_THREADS
-	std::mutex _streamMutex;
-#endif
+	// Streamed output.
+	FILE * _output = nullptr;
+	std::atomic<bool> _outputFailed {false}; ///< The consumer closed the stream.
+	static FILE * _standardOutput;
+
+	std::thread _writer;
+	std::map<size_t, size_t> _readyFrames; ///< Frames waiting to be encoded or written, and their buffer.
+	std::mutex _writerMutex;
+	std::condition_variable _frameReady;
+	bool _stopWriter = false;
 
 	std::chrono::time_point<std::chrono::high_resolution_clock> _startTime;
 };
@@ -32,6 +32,24 @@ std::string ResourcesManager::getStringForShader(const std::string & shaderName)
 	return "";
 }
 
+std::string ResourcesManager::getStringForShader(const std::string & shaderName, const std::vector<std::string> & defines){
+	std::string content = getStringForShader(shaderName);
+	if(content.empty() || defines.empty()){
+		return content;
+	}
+	std::string header;
+	for(const auto & define : defines){
+		header += "#define " + define + "\n";
+	}
+	// The version directive has to stay first.
+	const std::string::size_type lineEnd = content.find('\n');
+	if(lineEnd == std::string::npos){
+		return content + "\n" + header;
+	}
+	content.insert(lineEnd + 1, header);
+	return content;
+}
+
 void ResourcesManager::loadResources(){
 	shadersLibrary.clear();
 	imagesLibrary.clear();
@@ -14,6 +14,9 @@ class ResourcesManager {
 public:
 	
 	static std::string getStringForShader(const std::string & shaderName);
+
+	/// Shader source with the given preprocessor definitions inserted after its version directive.
+	static std::string getStringForShader(const std::string & shaderName, const std::vector<std::string> & defines);
 	
 	static void loadResources();
 	
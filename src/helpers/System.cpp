@@ -196,6 +196,15 @@ std::string System::loadStringFromFile(const std::string& path){
 	return str;
 }
 
+uint64_t System::hash(const std::string& str, uint64_t seed){
+	uint64_t hash = seed;
+	for(const char c : str){
+		hash ^= uint64_t((unsigned char)c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
 void System::writeStringToFile(const std::string& path, const std::string& content){
 	std::ofstream file = System::openOutputFile(path, false);
 	if(file.is_open()){
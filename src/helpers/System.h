@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <string>
+#include <cstdint>
 
 /**
  \brief Performs system basic operations such as directory creation, timing, threading, file picking.
@@ -30,6 +31,9 @@ public:
 	static std::string loadStringFromFile(const std::string& path);
 	static void writeStringToFile(const std::string& path, const std::string& content);
 
+	/// FNV-1a, stable across runs and platforms unlike std::hash. Pass a previous hash to combine strings.
+	static uint64_t hash(const std::string& str, uint64_t seed = 14695981039346656037ull);
+
 	/** Create a directory.
 		 \param directory the path to the directory to create
 		 \return true if the creation is successful.
@@ -0,0 +1,88 @@
+#include <iostream>
+
+#include "System.h"
+#include "Trace.h"
+
+std::atomic<bool> Trace::_enabled(false);
+std::string Trace::_path;
+std::chrono::steady_clock::time_point Trace::_origin;
+std::mutex Trace::_buffersMutex;
+std::vector<std::unique_ptr<Trace::ThreadBuffer>> Trace::_buffers;
+
+void Trace::start(const std::string & path){
+#ifdef MIDIVIZ_SUPPORT_TRACING
+	_path = path;
+	_origin = std::chrono::steady_clock::now();
+	_enabled = true;
+	setThreadName("Main");
+#else
+	std::cerr << "[TRACE]: Tracing is not supported by this build, ignoring " << path << "." << std::endl;
+#endif
+}
+
+bool Trace::stop(){
+	if(!enabled()){
+		return false;
+	}
+	_enabled = false;
+
+	std::ofstream file = System::openOutputFile(_path);
+	if(!file.is_open()){
+		std::cerr << "[TRACE]: Unable to write trace to " << _path << "." << std::endl;
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(_buffersMutex);
+	size_t count = 0;
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << "\n";
+	bool first = true;
+	for(const auto & buffer : _buffers){
+		if(!buffer->name.empty()){
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+			first = false;
+		}
+		for(const Event & event : buffer->events){
+			file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id;
+			file << ",\"ts\":" << event.begin << ",\"dur\":" << event.duration << "}";
+			first = false;
+		}
+		count += buffer->events.size();
+	}
+	file << "\n" << "]}" << "\n";
+	file.close();
+	// Keep the buffers, threads still reference them.
+	for(auto & buffer : _buffers){
+		buffer->events.clear();
+	}
+	std::cout << "[TRACE]: Wrote " << count << " events to " << _path << "." << std::endl;
+	return true;
+}
+
+void Trace::setThreadName(const std::string & name){
+	if(!enabled()){
+		return;
+	}
+	threadBuffer().name = name;
+}
+
+void Trace::addEvent(const char * name, const std::chrono::steady_clock::time_point & begin, const std::chrono::steady_clock::time_point & end){
+	if(!enabled()){
+		return;
+	}
+	Event event;
+	event.name = name;
+	event.begin = std::chrono::duration_cast<std::chrono::microseconds>(begin - _origin).count();
+	event.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+	threadBuffer().events.push_back(event);
+}
+
+Trace::ThreadBuffer & Trace::threadBuffer(){
+	// Buffers are owned by the trace so that they remain valid after their thread exits.
+	thread_local ThreadBuffer * buffer = nullptr;
+	if(buffer == nullptr){
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		_buffers.emplace_back(new ThreadBuffer());
+		buffer = _buffers.back().get();
+		buffer->id = (unsigned int)_buffers.size();
+	}
+	return *buffer;
+}
@@ -0,0 +1,91 @@
+#ifndef Trace_h
+#define Trace_h
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Scoped CPU tracing, written as a Chrome/Perfetto trace-event JSON file.
+/// Each thread records its events in its own buffer, only registering it once under a lock.
+/// Scope names have to outlive the trace (string literals or persistent strings).
+/// Building without MIDIVIZ_SUPPORT_TRACING removes all instrumentation.
+class Trace {
+
+public:
+
+	/// Start recording events, to be written to the given path when stopping.
+	static void start(const std::string & path);
+
+	/// Write all recorded events and stop recording.
+	/// Threads recording events should be done beforehand.
+	static bool stop();
+
+	static bool enabled(){ return _enabled.load(std::memory_order_relaxed); }
+
+	/// Name displayed for the calling thread in the trace viewer.
+	static void setThreadName(const std::string & name);
+
+	/// Record a complete event on the calling thread.
+	static void addEvent(const char * name, const std::chrono::steady_clock::time_point & begin, const std::chrono::steady_clock::time_point & end);
+
+private:
+
+	struct Event {
+		const char * name;
+		long long begin; ///< Microseconds since the start of the trace.
+		long long duration; ///< Microseconds.
+	};
+
+	struct ThreadBuffer {
+		std::vector<Event> events;
+		std::string name;
+		unsigned int id = 0;
+	};
+
+	static ThreadBuffer & threadBuffer();
+
+	static std::atomic<bool> _enabled;
+	static std::string _path;
+	static std::chrono::steady_clock::time_point _origin;
+	static std::mutex _buffersMutex;
+	static std::vector<std::unique_ptr<ThreadBuffer>> _buffers;
+};
+
+/// Record the lifetime of the scope as an event.
+class TraceScope {
+
+public:
+
+	TraceScope(const char * name) : _name(name), _active(Trace::enabled()) {
+		if(_active){
+			_begin = std::chrono::steady_clock::now();
+		}
+	}
+
+	~TraceScope(){
+		if(_active){
+			Trace::addEvent(_name, _begin, std::chrono::steady_clock::now());
+		}
+	}
+
+private:
+	const char * _name;
+	const bool _active;
+	std::chrono::steady_clock::time_point _begin;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef MIDIVIZ_SUPPORT_TRACING
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD(name)
+#endif
+
+#endif
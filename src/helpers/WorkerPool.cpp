@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <chrono>
+
+#include "Trace.h"
+#include "WorkerPool.h"
+
+WorkerPool::~WorkerPool(){
+	stop();
+}
+
+void WorkerPool::start(size_t workers, size_t capacity, const std::string & name){
+	workers = (std::max)(workers, size_t(1));
+	capacity = (std::max)(capacity, size_t(1));
+	if(_threads.size() == workers && _capacity == capacity && _name == name){
+		return;
+	}
+	stop();
+	_capacity = capacity;
+	_name = name;
+	_stopping = false;
+	for(size_t tid = 0; tid < workers; ++tid){
+		_threads.emplace_back(&WorkerPool::run, this);
+	}
+}
+
+void WorkerPool::push(const Job & job){
+	std::unique_lock<std::mutex> lock(_mutex);
+	if(_jobs.size() >= _capacity){
+		// Backpressure: wait for a worker to take a job.
+		TRACE_SCOPE("Wait for queue");
+		const auto start = std::chrono::steady_clock::now();
+		_notFull.wait(lock, [this](){ return _jobs.size() < _capacity; });
+		++_stats.stalls;
+		_stats.stallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	_jobs.push_back(job);
+	_stats.queued = _jobs.size();
+	_stats.maxQueued = (std::max)(_stats.maxQueued, _stats.queued);
+	lock.unlock();
+	_notEmpty.notify_one();
+}
+
+void WorkerPool::wait(){
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, [this](){ return _jobs.empty() && _stats.running == 0; });
+}
+
+void WorkerPool::stop(){
+	if(_threads.empty()){
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_notEmpty.notify_all();
+	for(auto & thread : _threads){
+		thread.join();
+	}
+	_threads.clear();
+}
+
+WorkerPool::Stats WorkerPool::stats() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+void WorkerPool::resetStats(){
+	std::lock_guard<std::mutex> lock(_mutex);
+	const size_t running = _stats.running;
+	_stats = Stats();
+	_stats.queued = _jobs.size();
+	_stats.running = running;
+}
+
+void WorkerPool::run(){
+	TRACE_THREAD(_name);
+	while(true){
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			// Remaining jobs are completed before stopping.
+			_notEmpty.wait(lock, [this](){ return _stopping || !_jobs.empty(); });
+			if(_jobs.empty()){
+				return;
+			}
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+			_stats.queued = _jobs.size();
+			++_stats.running;
+		}
+		_notFull.notify_one();
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			--_stats.running;
+			++_stats.completed;
+		}
+		_idle.notify_all();
+	}
+}
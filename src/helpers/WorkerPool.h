@@ -0,0 +1,68 @@
+#ifndef WorkerPool_h
+#define WorkerPool_h
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Persistent threads running jobs from a bounded queue.
+/// Any thread can add jobs, blocking while the queue is full so that producers can't outpace the workers.
+class WorkerPool {
+
+public:
+
+	typedef std::function<void()> Job;
+
+	/// Queue usage since the last reset.
+	struct Stats {
+		size_t queued = 0; ///< Jobs waiting for a worker.
+		size_t running = 0; ///< Jobs being run.
+		size_t maxQueued = 0;
+		size_t completed = 0;
+		size_t stalls = 0; ///< Jobs that had to wait for room in the queue.
+		double stallTime = 0.0; ///< Seconds spent waiting for room in the queue.
+	};
+
+	~WorkerPool();
+
+	/// Start the workers, if they are not already running with the same configuration.
+	/// \param name displayed in traces
+	void start(size_t workers, size_t capacity, const std::string & name);
+
+	/// Add a job, blocking while the queue is full.
+	void push(const Job & job);
+
+	/// Wait until all jobs are complete.
+	void wait();
+
+	/// Complete all jobs and join the workers.
+	void stop();
+
+	size_t workers() const { return _threads.size(); }
+
+	Stats stats() const;
+
+	void resetStats();
+
+private:
+
+	void run();
+
+	std::vector<std::thread> _threads;
+	std::deque<Job> _jobs;
+	size_t _capacity = 1;
+	std::string _name;
+	bool _stopping = false;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _notEmpty; ///< Signaled when a job is added or the pool stops.
+	std::condition_variable _notFull; ///< Signaled when a job is taken.
+	std::condition_variable _idle; ///< Signaled when a job completes.
+	Stats _stats;
+};
+
+#endif
@@ -2,11 +2,14 @@
 #include <GLFW/glfw3.h> // to set up the OpenGL context and manage window lifecycle and inputs
 #include "helpers/ProgramUtilities.h"
 #include "helpers/Configuration.h"
+#include "helpers/HeadlessContext.h"
+#include "helpers/Trace.h"
 #include "helpers/ResourcesManager.h"
 #include "helpers/ImGuiStyle.h"
 #include "helpers/System.h"
 
 #include "rendering/Renderer.h"
+#include "rendering/ProgramCache.h"
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_glfw.h>
@@ -30,24 +33,52 @@ void rescale_callback(GLFWwindow* window, float xscale, float yscale){
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods){
+	// Get pointer to the renderer.
+	Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	renderer->requestRedraw();
 	if(!ImGui::GetIO().WantCaptureKeyboard){
-		// Get pointer to the renderer.
-		Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
 		renderer->keyPressed(key, action);
 	}
 	ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset){
+	Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	renderer->requestRedraw();
 	ImGui_ImplGlfw_ScrollCallback(window, xoffset, yoffset);
 }
 
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods){
+	Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	renderer->requestRedraw();
+	ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
+}
+
+void cursor_callback(GLFWwindow* window, double, double){
+	// ImGui polls the cursor position, we only need to wake up.
+	Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	renderer->requestRedraw();
+}
+
+void char_callback(GLFWwindow* window, unsigned int c){
+	Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	renderer->requestRedraw();
+	ImGui_ImplGlfw_CharCallback(window, c);
+}
+
+void focus_callback(GLFWwindow* window, int focused){
+	Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	renderer->requestRedraw();
+	ImGui_ImplGlfw_WindowFocusCallback(window, focused);
+}
+
 void drop_callback(GLFWwindow* window, int count, const char** paths){
 	if(count == 0){
 		return;
 	}
 
 	Renderer *renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	renderer->requestRedraw();
 	bool loadedMIDI = false;
 	bool loadedConfig = false;
 	for(unsigned int i = 0; i < count; ++i){
@@ -131,15 +162,82 @@ void performAction(SystemAction action, GLFWwindow * window, glm::ivec4 & frame)
 	}
 }
 
+/// Load the MIDI file and the display settings specified in the configuration.
+
+void loadMidiAndState(Renderer & renderer, const Configuration & config){
+	// Load midi file if specified.
+	if(!config.lastMidiPath.empty()){
+		renderer.loadMidiFile(config.lastMidiPath);
+	}
+	// Apply custom state.
+	State state;
+	if(!config.lastConfigPath.empty()){
+		state.load(config.lastConfigPath);
+	}
+	// Apply any extra display argument on top of the existing config.
+	state.load(config.args());
+	renderer.setState(state);
+}
+
+/// Direct export without any window, in an offscreen context.
+
+int runHeadless(const Configuration & config, const std::string & applicationDataPath){
+	if(config.exporting.path.empty()){
+		std::cerr << "[ERROR]: Headless mode requires an export path (--export)." << std::endl;
+		return 2;
+	}
+	HeadlessContext context;
+	if(!context.init()){
+		return 2;
+	}
+	std::cout << "[HEADLESS]: Rendering with " << context.backend() << "." << std::endl;
+
+	if (gl3wInit2(HeadlessContext::getProcAddress)) {
+		std::cerr << "[ERROR]: Failed to initialize OpenGL" << std::endl;
+		context.clean();
+		return -1;
+	}
+	if (!gl3wIsSupported(3, 2)) {
+		std::cerr << "[ERROR]: OpenGL 3.2 not supported\n" << std::endl;
+		context.clean();
+		return -1;
+	}
+	if(!applicationDataPath.empty()){
+		ProgramCache::init(applicationDataPath + "shaders/");
+	}
+
+	int result = 0;
+	// We need a scope to ensure the renderer is deleted before the OpenGL context is destroyed.
+	{
+		ResourcesManager::loadResources();
+		Renderer renderer(config);
+		loadMidiAndState(renderer, config);
+		renderer.resizeAndRescale(config.windowSize[0], config.windowSize[1], 1.0f);
+
+		if(renderer.startDirectRecording(config.exporting, config.windowSize)){
+			// There is no GUI nor event to process, render until the export is complete.
+			while(renderer.isRecording()){
+				if(renderer.draw(0.0f).type == SystemAction::QUIT){
+					break;
+				}
+			}
+			glFinish();
+		} else {
+			result = 2;
+		}
+		renderer.clean();
+	}
+	context.clean();
+	return result;
+}
+
 /// The main function
 
 int main( int argc, char** argv) {
 
 	// Initialize glfw, which will create and setup an OpenGL context.
-	if (!glfwInit()) {
-		std::cerr << "[ERROR]: could not start GLFW3" << std::endl;
-		return 2;
-	}
+	// Failure is only fatal if we can't fall back to headless export.
+	const bool glfwReady = glfwInit() == GLFW_TRUE;
 	
 	// Retrieve the settings directory for all applications.
 	std::string applicationDataPath = System::getApplicationDataDirectory();
@@ -168,6 +266,35 @@ int main( int argc, char** argv) {
 		glfwTerminate();
 		return 0;
 	}
+	if(!config.concatPaths.empty()){
+		const std::vector<std::string> segments(config.concatPaths.begin() + 1, config.concatPaths.end());
+		const bool success = Recorder::concatenate(segments, config.concatPaths[0]);
+		glfwTerminate();
+		return success ? 0 : 1;
+	}
+	// Frames streamed to the standard output should not be mixed with logs.
+	if(config.exporting.path == "-"){
+		Recorder::reserveStandardOutput();
+	}
+	if(!config.tracePath.empty()){
+		Trace::start(config.tracePath);
+	}
+
+	// Without a display server, exports can still be performed offscreen.
+	if(!glfwReady && !config.headless){
+		if(config.exporting.path.empty()){
+			std::cerr << "[ERROR]: could not start GLFW3" << std::endl;
+			return 2;
+		}
+		std::cout << "[HEADLESS]: Could not start GLFW3, exporting without a window." << std::endl;
+		config.headless = true;
+	}
+	if(config.headless){
+		const int result = runHeadless(config, applicationDataPath);
+		Trace::stop();
+		glfwTerminate();
+		return result;
+	}
 	
 	// On OS X, the correct OpenGL profile and version to use have to be explicitely defined.
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -203,6 +330,11 @@ int main( int argc, char** argv) {
 		return -1;
 	}
 
+	// Cache linked shader programs next to the configuration.
+	if(!applicationDataPath.empty()){
+		ProgramCache::init(applicationDataPath + "shaders/");
+	}
+
 	// The font should be maintained alive until the atlas is built.
 	ImFontConfig font;
 	// We need a scope to ensure the renderer is deleted before the OpenGL context is destroyed.
@@ -222,24 +354,12 @@ int main( int argc, char** argv) {
 		ImGui_ImplGlfw_InitForOpenGL(window, false);
 		ImGui_ImplOpenGL3_Init("#version 330");
 
-		// Load midi file if specified.
-		if(!config.lastMidiPath.empty()){
-			renderer.loadMidiFile(config.lastMidiPath);
-		}
+		loadMidiAndState(renderer, config);
 
 		// Load audio file if specified.
 		if(!config.lastAudioPath.empty()){
 			renderer.loadAudioFile(config.lastAudioPath);
 		}
-		
-		// Apply custom state.
-		State state;
-		if(!config.lastConfigPath.empty()){
-			state.load(config.lastConfigPath);
-		}
-		// Apply any extra display argument on top of the existing config.
-		state.load(config.args());
-		renderer.setState(state);
 
 		// Connect to MIDI device if specified. We do it after setting the state because there are constraints on the scroll direction when recording.
 		// But we don't want to force reverse-scroll when playing back a recorded liveplay.
@@ -252,7 +372,10 @@ int main( int argc, char** argv) {
 		glfwSetFramebufferSizeCallback(window, resize_callback);
 		glfwSetKeyCallback(window,key_callback);
 		glfwSetScrollCallback(window,scroll_callback);
-		glfwSetCharCallback(window, ImGui_ImplGlfw_CharCallback);
+		glfwSetCharCallback(window, char_callback);
+		glfwSetMouseButtonCallback(window, mouse_button_callback);
+		glfwSetCursorPosCallback(window, cursor_callback);
+		glfwSetWindowFocusCallback(window, focus_callback);
 		glfwSetDropCallback(window, drop_callback);
 		glfwSwapInterval(1);
 
@@ -301,7 +424,12 @@ int main( int argc, char** argv) {
 			//Display the result fo the current rendering loop.
 			glfwSwapBuffers(window);
 			// Update events (inputs,...).
-			glfwPollEvents();
+			// When nothing changes on screen, sleep until the next event instead of rendering at the display rate.
+			if(renderer.isIdle()){
+				glfwWaitEventsTimeout(0.25);
+			} else {
+				glfwPollEvents();
+			}
 
 		}
 		// Refresh and save global settings.
@@ -315,6 +443,8 @@ int main( int argc, char** argv) {
 		ImGui::DestroyContext();
 		renderer.clean();
 	}
+	// Export threads are done, write the trace.
+	Trace::stop();
 
 	// Remove the window.
 	glfwDestroyWindow(window);
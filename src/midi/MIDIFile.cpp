@@ -4,22 +4,27 @@
 
 #include "MIDIFile.h"
 #include "../helpers/System.h"
+#include "../helpers/Trace.h"
 
 MIDIFile::MIDIFile(){};
 
 MIDIFile::MIDIFile(const std::string & filePath){
-	std::ifstream input = System::openInputFile(filePath, true);
+	TRACE_SCOPE("Load MIDI file");
+	std::vector<char> buffer;
+	{
+		TRACE_SCOPE("Read MIDI file");
+		std::ifstream input = System::openInputFile(filePath, true);
 
-	if(!input.is_open()) {
-		std::cerr << "[ERROR]: Couldn't find file at path " << filePath << std::endl;
-		throw "BadInput";
+		if(!input.is_open()) {
+			std::cerr << "[ERROR]: Couldn't find file at path " << filePath << std::endl;
+			throw "BadInput";
+		}
+
+		std::copy(std::istreambuf_iterator<char>(input),
+				  std::istreambuf_iterator<char>(),
+				  std::back_inserter(buffer));
+		input.close();
 	}
-	
-	std::vector<char> buffer;
-	std::copy(std::istreambuf_iterator<char>(input),
-			  std::istreambuf_iterator<char>(),
-			  std::back_inserter(buffer));
-	input.close();
 
 	// Check midi header
 	if(buffer.size() < 5 || !(buffer[0] == 'M' && buffer[1] == 'T' && buffer[2] == 'h' && buffer[3] == 'd') || read32(buffer, 4) != 6){
@@ -75,11 +80,14 @@ MIDIFile::MIDIFile(const std::string & filePath){
 	}
 
 	// Parse tracks.
-	size_t pos = 14;
-	for(size_t trackId = 0; trackId < tracksCount; ++trackId){
-		std::cout << "[INFO]: " << "Reading track " << trackId << "." << std::endl;
-		_tracks.emplace_back();
-		pos = _tracks.back().readTrack(buffer, pos);
+	{
+		TRACE_SCOPE("Parse tracks");
+		size_t pos = 14;
+		for(size_t trackId = 0; trackId < tracksCount; ++trackId){
+			std::cout << "[INFO]: " << "Reading track " << trackId << "." << std::endl;
+			_tracks.emplace_back();
+			pos = _tracks.back().readTrack(buffer, pos);
+		}
 	}
 
 	// Extract tempos and the signature.
@@ -89,14 +97,18 @@ MIDIFile::MIDIFile(const std::string & filePath){
 	_secondsPerMeasure = computeMeasureDuration(_tempos[0].tempo, _signature);
 
 	// Convert each track to real notes.
-	for(size_t tid = 0; tid < _tracks.size(); ++tid){
-		auto & track = _tracks[tid];
-		track.extractNotes(_tempos, _unitsPerQuarterNote, (unsigned int)tid);
+	{
+		TRACE_SCOPE("Extract notes");
+		for(size_t tid = 0; tid < _tracks.size(); ++tid){
+			auto & track = _tracks[tid];
+			track.extractNotes(_tempos, _unitsPerQuarterNote, (unsigned int)tid);
+		}
 	}
 
 	// For now, still merge.
 	shouldMerge = true;
 	if(shouldMerge){
+		TRACE_SCOPE("Merge tracks");
 		mergeTracks();
 	}
 
@@ -38,7 +38,7 @@ int main( int argc, char** argv) {
 	const std::string outputDir = baseDir + "/src/resources/";
 	
 	std::vector<std::string> imagesToLoad = { "flash", "font", "particles"};
-	std::vector<std::string> shadersToLoad = { "background", "flashes", "notes", "particles", "particlesblur", "screenquad", "keys", "backgroundtexture", "pedal", "wave", "fxaa"};
+	std::vector<std::string> shadersToLoad = { "background", "flashes", "notes", "particles", "particlesblurdown", "particlesblurup", "screenquad", "scrollingcache", "exportplanes", "exportrgba", "keys", "backgroundtexture", "pedal", "wave", "fxaa"};
 	
 	// Header file.
 	std::ofstream headerFile(outputDir + "data.h");
@@ -105,21 +105,24 @@ int main( int argc, char** argv) {
 		const std::string shaderBasePath = resourcesDir + "shaders/" + shaderName;
 		std::ifstream vertShader(shaderBasePath + ".vert");
 		std::ifstream fragShader(shaderBasePath + ".frag");
-		if(!vertShader.is_open() || !fragShader.is_open()){
+		// Some programs only provide a fragment shader and rely on an existing vertex shader.
+		if(!fragShader.is_open()){
 			std::cerr << "Unable to open handle to shaders input file for " << shaderName << "." << std::endl;
 			continue;
 		}
 		std::string buffLine;
 		
 		// Vertex shader content.
-		shadersOutput << "{ \"" << shaderName << "_" << "vert" << "\", \"";
-		while (std::getline(vertShader, buffLine)) {
-			if(buffLine.empty()){
-				continue;
+		if(vertShader.is_open()){
+			shadersOutput << "{ \"" << shaderName << "_" << "vert" << "\", \"";
+			while (std::getline(vertShader, buffLine)) {
+				if(buffLine.empty()){
+					continue;
+				}
+				shadersOutput << buffLine << "\\n ";
 			}
-			shadersOutput << buffLine << "\\n ";
+			shadersOutput << "\"}, " << "\n";
 		}
-		shadersOutput << "\"}, " << "\n";
 		
 		// Fragment shader content.
 		shadersOutput << "{ \"" << shaderName << "_" << "frag" << "\", \"";
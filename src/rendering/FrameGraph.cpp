@@ -0,0 +1,255 @@
+#include <algorithm>
+
+#include "FrameGraph.h"
+
+const unsigned int FrameGraph::_maxUnusedFrames;
+
+void FrameGraph::reset(){
+	_resources.clear();
+	_passes.clear();
+}
+
+FrameGraph::Target FrameGraph::import(const std::string & name, const std::shared_ptr<Framebuffer> & framebuffer){
+	Resource resource;
+	resource.name = name;
+	resource.size = glm::ivec2(framebuffer->_width, framebuffer->_height);
+	resource.internalFormat = framebuffer->internalFormat();
+	resource.framebuffer = framebuffer;
+	resource.imported = true;
+	resource.alias = Target(_resources.size());
+	_resources.push_back(resource);
+	return resource.alias;
+}
+
+FrameGraph::Target FrameGraph::create(const std::string & name, const glm::ivec2 & size, GLuint internalFormat){
+	Resource resource;
+	resource.name = name;
+	resource.size = glm::max(size, glm::ivec2(1));
+	resource.internalFormat = internalFormat;
+	resource.alias = Target(_resources.size());
+	_resources.push_back(resource);
+	return resource.alias;
+}
+
+void FrameGraph::addPass(const std::string & name, const std::vector<Target> & reads, const std::vector<Target> & writes, const std::function<void()> & execute){
+	Pass pass;
+	pass.name = name;
+	pass.reads = reads;
+	pass.writes = writes;
+	pass.execute = execute;
+	_passes.push_back(pass);
+}
+
+void FrameGraph::addCopy(const std::string & name, Target src, Target dst){
+	addPass(name, {src}, {dst}, [this, src, dst](){
+		const std::shared_ptr<Framebuffer> & from = framebuffer(src);
+		const std::shared_ptr<Framebuffer> & to = framebuffer(dst);
+		from->bind(GL_READ_FRAMEBUFFER);
+		to->bind(GL_DRAW_FRAMEBUFFER);
+		glBlitFramebuffer(0, 0, from->_width, from->_height, 0, 0, to->_width, to->_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		to->unbind();
+	});
+	_passes.back().copy = true;
+}
+
+void FrameGraph::execute(){
+	++_frame;
+	for(auto & pass : _passes){
+		pass.skipped = false;
+	}
+	elideCopies();
+	cullPasses();
+	computeLifetimes();
+
+	_stats = Stats();
+	for(int pid = 0; pid < int(_passes.size()); ++pid){
+		Pass & pass = _passes[pid];
+		if(pass.skipped){
+			++_stats.skipped;
+			continue;
+		}
+		for(auto & resource : _resources){
+			if(resource.firstUse == pid){
+				resource.framebuffer = acquire(resource.size, resource.internalFormat);
+			}
+		}
+		pass.execute();
+		++_stats.passes;
+		for(auto & resource : _resources){
+			if(resource.lastUse == pid){
+				release(resource.framebuffer);
+			}
+		}
+	}
+
+	trimPool();
+	for(const auto & resource : _resources){
+		_stats.transients += resource.imported ? 0 : 1;
+	}
+	for(const auto & entry : _pool){
+		++_stats.pooled;
+		const size_t texelSize = entry.framebuffer->internalFormat() == GL_RGBA16F ? 8 : 4;
+		_stats.pooledBytes += size_t(entry.framebuffer->_width) * size_t(entry.framebuffer->_height) * texelSize;
+	}
+}
+
+const std::shared_ptr<Framebuffer> & FrameGraph::framebuffer(Target target) const {
+	return _resources[resolve(target)].framebuffer;
+}
+
+FrameGraph::Target FrameGraph::resolve(Target target) const {
+	while(_resources[target].alias != target){
+		target = _resources[target].alias;
+	}
+	return target;
+}
+
+bool FrameGraph::uses(const Pass & pass, Target target) const {
+	const Target resolved = resolve(target);
+	for(const Target read : pass.reads){
+		if(resolve(read) == resolved){
+			return true;
+		}
+	}
+	for(const Target write : pass.writes){
+		if(resolve(write) == resolved){
+			return true;
+		}
+	}
+	return false;
+}
+
+void FrameGraph::elideCopies(){
+	const int passesCount = int(_passes.size());
+	for(int pid = 0; pid < passesCount; ++pid){
+		Pass & copy = _passes[pid];
+		if(!copy.copy){
+			continue;
+		}
+		const Target src = resolve(copy.reads[0]);
+		const Target dst = resolve(copy.writes[0]);
+		if(src == dst){
+			copy.skipped = true;
+			continue;
+		}
+		// Only a transient source can be rendered elsewhere, and without rescaling nor conversion.
+		if(_resources[src].imported || _resources[src].size != _resources[dst].size || _resources[src].internalFormat != _resources[dst].internalFormat){
+			continue;
+		}
+		// The destination must be untouched while the source is alive, and the source unused afterwards.
+		int firstUse = pid;
+		for(int oid = 0; oid < pid; ++oid){
+			if(uses(_passes[oid], src)){
+				firstUse = oid;
+				break;
+			}
+		}
+		bool conflict = false;
+		for(int oid = firstUse; oid < passesCount && !conflict; ++oid){
+			if(oid == pid){
+				continue;
+			}
+			conflict = (oid < pid && uses(_passes[oid], dst)) || (oid > pid && uses(_passes[oid], src));
+		}
+		if(conflict){
+			continue;
+		}
+		_resources[src].alias = dst;
+		copy.skipped = true;
+	}
+}
+
+void FrameGraph::cullPasses(){
+	// Walk back from the imported targets, keeping the passes their content depends on.
+	std::vector<bool> needed(_resources.size(), false);
+	for(int pid = int(_passes.size()) - 1; pid >= 0; --pid){
+		Pass & pass = _passes[pid];
+		if(pass.skipped){
+			continue;
+		}
+		bool contributes = false;
+		for(const Target write : pass.writes){
+			const Target resolved = resolve(write);
+			contributes = contributes || _resources[resolved].imported || needed[resolved];
+		}
+		if(!contributes){
+			pass.skipped = true;
+			continue;
+		}
+		for(const Target read : pass.reads){
+			needed[resolve(read)] = true;
+		}
+	}
+}
+
+void FrameGraph::computeLifetimes(){
+	for(auto & resource : _resources){
+		resource.firstUse = -1;
+		resource.lastUse = -1;
+	}
+	for(int pid = 0; pid < int(_passes.size()); ++pid){
+		const Pass & pass = _passes[pid];
+		if(pass.skipped){
+			continue;
+		}
+		std::vector<Target> targets(pass.reads);
+		targets.insert(targets.end(), pass.writes.begin(), pass.writes.end());
+		for(const Target target : targets){
+			Resource & resource = _resources[resolve(target)];
+			if(resource.imported){
+				continue;
+			}
+			resource.firstUse = resource.firstUse < 0 ? pid : resource.firstUse;
+			resource.lastUse = pid;
+		}
+	}
+}
+
+std::shared_ptr<Framebuffer> FrameGraph::acquire(const glm::ivec2 & size, GLuint internalFormat){
+	for(auto & entry : _pool){
+		if(!entry.used && entry.framebuffer->_width == size[0] && entry.framebuffer->_height == size[1] && entry.framebuffer->internalFormat() == internalFormat){
+			entry.used = true;
+			entry.lastFrame = _frame;
+			return entry.framebuffer;
+		}
+	}
+	PoolEntry entry;
+	entry.framebuffer = std::shared_ptr<Framebuffer>(new Framebuffer(size[0], size[1], internalFormat, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE));
+	entry.used = true;
+	entry.lastFrame = _frame;
+	_pool.push_back(entry);
+	return entry.framebuffer;
+}
+
+void FrameGraph::release(const std::shared_ptr<Framebuffer> & framebuffer){
+	for(auto & entry : _pool){
+		if(entry.framebuffer == framebuffer){
+			entry.used = false;
+			return;
+		}
+	}
+}
+
+void FrameGraph::trimPool(){
+	const unsigned int frame = _frame;
+	_pool.erase(std::remove_if(_pool.begin(), _pool.end(), [frame](const PoolEntry & entry){
+		return !entry.used && (frame - entry.lastFrame) > _maxUnusedFrames;
+	}), _pool.end());
+}
+
+void FrameGraph::purge(){
+	// Transient targets keep a reference until the next frame, drop them too.
+	for(auto & resource : _resources){
+		if(!resource.imported){
+			resource.framebuffer.reset();
+		}
+	}
+	_pool.erase(std::remove_if(_pool.begin(), _pool.end(), [](const PoolEntry & entry){
+		return !entry.used;
+	}), _pool.end());
+}
+
+void FrameGraph::clean(){
+	reset();
+	_pool.clear();
+}
@@ -0,0 +1,116 @@
+#ifndef FrameGraph_h
+#define FrameGraph_h
+#include <gl3w/gl3w.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Framebuffer.h"
+
+/// Description of the passes of a frame and of the targets they read and write.
+/// Persistent framebuffers are imported, other targets are transient: they are taken from a pool
+/// before their first use and given back after their last one, so that targets of the same size
+/// whose lifetimes don't overlap share the same framebuffer.
+/// Passes that don't contribute to an imported target are skipped, and so are copies that can be
+/// avoided by rendering their source directly in their destination.
+class FrameGraph {
+
+public:
+
+	typedef unsigned int Target;
+
+	/// Number of passes and framebuffers used by the last executed frame.
+	struct Stats {
+		unsigned int passes = 0; ///< Executed passes.
+		unsigned int skipped = 0; ///< Culled passes and elided copies.
+		unsigned int transients = 0; ///< Declared transient targets.
+		unsigned int pooled = 0; ///< Framebuffers backing them.
+		size_t pooledBytes = 0;
+	};
+
+	/// Start describing a new frame.
+	void reset();
+
+	/// Register a persistent framebuffer, its content is kept between frames.
+	Target import(const std::string & name, const std::shared_ptr<Framebuffer> & framebuffer);
+
+	/// Declare a transient target, RGBA8 by default, its content is undefined before the first pass writing it.
+	Target create(const std::string & name, const glm::ivec2 & size, GLuint internalFormat = GL_RGBA);
+
+	/// Declare a pass, passes are run in declaration order.
+	void addPass(const std::string & name, const std::vector<Target> & reads, const std::vector<Target> & writes, const std::function<void()> & execute);
+
+	/// Declare a full copy of a target into another one of the same size.
+	void addCopy(const std::string & name, Target src, Target dst);
+
+	/// Skip unneeded passes, assign framebuffers to the transient targets and run the passes.
+	void execute();
+
+	/// Framebuffer backing a target, only valid in the passes using it.
+	const std::shared_ptr<Framebuffer> & framebuffer(Target target) const;
+
+	/// Release all pooled framebuffers, for instance after a resolution change.
+	void purge();
+
+	const Stats & lastFrame() const { return _stats; }
+
+	/// Clean function
+	void clean();
+
+private:
+
+	struct Resource {
+		std::string name;
+		glm::ivec2 size;
+		GLuint internalFormat = GL_RGBA;
+		std::shared_ptr<Framebuffer> framebuffer;
+		bool imported = false;
+		Target alias; ///< Target actually rendered to, itself by default.
+		int firstUse = -1;
+		int lastUse = -1;
+	};
+
+	struct Pass {
+		std::string name;
+		std::vector<Target> reads;
+		std::vector<Target> writes;
+		std::function<void()> execute;
+		bool copy = false;
+		bool skipped = false;
+	};
+
+	struct PoolEntry {
+		std::shared_ptr<Framebuffer> framebuffer;
+		bool used = false;
+		unsigned int lastFrame = 0;
+	};
+
+	Target resolve(Target target) const;
+
+	bool uses(const Pass & pass, Target target) const;
+
+	void elideCopies();
+
+	void cullPasses();
+
+	void computeLifetimes();
+
+	std::shared_ptr<Framebuffer> acquire(const glm::ivec2 & size, GLuint internalFormat);
+
+	void release(const std::shared_ptr<Framebuffer> & framebuffer);
+
+	/// Drop the framebuffers unused for a few frames.
+	void trimPool();
+
+	std::vector<Resource> _resources;
+	std::vector<Pass> _passes;
+	std::vector<PoolEntry> _pool;
+	unsigned int _frame = 0;
+	Stats _stats;
+
+	static const unsigned int _maxUnusedFrames = 4;
+};
+
+#endif
@@ -3,18 +3,24 @@
 
 #include "../helpers/ProgramUtilities.h"
 #include "Framebuffer.h"
+#include "GLState.h"
 
 
-Framebuffer::Framebuffer(int width, int height, GLuint format, GLuint type, GLuint filtering, GLuint wrapping) : _width(width),  _height(height){
+Framebuffer::Framebuffer(int width, int height, GLuint format, GLuint type, GLuint filtering, GLuint wrapping) :
+	Framebuffer(width, height, format, format, type, filtering, wrapping) {
+}
+
+Framebuffer::Framebuffer(int width, int height, GLuint internalFormat, GLuint format, GLuint type, GLuint filtering, GLuint wrapping) : _width(width),  _height(height),
+	_internalFormat(internalFormat), _format(format), _type(type) {
 
 	// Create a framebuffer.
 	glGenFramebuffers(1, &_id);
 	glBindFramebuffer(GL_FRAMEBUFFER, _id);
 	
-	// Create the texture to store the result.
+	// Create the texture to store the result. Framebuffers can be created during a frame, keep the cached bindings valid.
 	glGenTextures(1, &_idColor);
-	glBindTexture(GL_TEXTURE_2D, _idColor);
-	glTexImage2D(GL_TEXTURE_2D, 0, format, _width , _height, 0, format, type, 0);
+	GLState::bindTexture(0, GL_TEXTURE_2D, _idColor);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, _width , _height, 0, format, type, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filtering);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filtering);
 	
@@ -29,13 +35,7 @@ Framebuffer::Framebuffer(int width, int height, GLuint format, GLuint type, GLui
 	// Link the texture to the first color attachment (ie output) of the framebuffer.
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 ,GL_TEXTURE_2D, _idColor, 0);
 	
-	// Create the renderbuffer (depth buffer + color(s) buffer(s)).
-	glGenRenderbuffers(1, &_idRenderbuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, _idRenderbuffer);
-	// Setup the depth buffer storage.
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, _width, _height);
-	// Link the renderbuffer to the framebuffer.
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _idRenderbuffer);
+	// No depth buffer, all passes are drawn in order without depth testing.
 	
 	//Register which color attachments to draw to.
 	GLenum drawBuffers[1] = {GL_COLOR_ATTACHMENT0};
@@ -63,13 +63,9 @@ void Framebuffer::resize(int width, int height){
 	if(width != _width || height != _height){
 		_width = width;
 		_height = height;
-		// Resize the renderbuffer.
-		glBindRenderbuffer(GL_RENDERBUFFER, _idRenderbuffer);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, _width, _height);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
 		// Resize the texture.
-		glBindTexture(GL_TEXTURE_2D, _idColor);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		GLState::bindTexture(0, GL_TEXTURE_2D, _idColor);
+		glTexImage2D(GL_TEXTURE_2D, 0, _internalFormat, _width, _height, 0, _format, _type, 0);
 	}
 	// Clear everything for safety;
 	bind();
@@ -82,8 +78,10 @@ void Framebuffer::resize(glm::vec2 size){
 }
 
 void Framebuffer::clean(){
-	glDeleteRenderbuffers(1, &_idRenderbuffer);
-	glDeleteTextures(1, &_idColor);
+	// Can be called explicitly and then by the destructor.
+	GLState::deleteTexture(_idColor);
 	glDeleteFramebuffers(1, &_id);
+	_idColor = 0;
+	_id = 0;
 }
 
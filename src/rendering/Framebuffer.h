@@ -9,9 +9,12 @@ class Framebuffer {
 
 public:
 	
-	/// Setup the framebuffer (attachments, renderbuffer, depth buffer, textures IDs,...)
+	/// Setup the framebuffer (color attachment, textures IDs,...)
 	Framebuffer(int width, int height, GLuint format, GLuint type, GLuint filtering, GLuint wrapping);
 
+	/// Setup the framebuffer with an explicit sized internal format (for instance GL_R16).
+	Framebuffer(int width, int height, GLuint internalFormat, GLuint format, GLuint type, GLuint filtering, GLuint wrapping);
+
 	~Framebuffer();
 	
 	/// Bind the framebuffer.
@@ -32,6 +35,8 @@ public:
 	
 	/// The ID to the texture containing the result of the framebuffer pass.
 	GLuint textureId() { return _idColor; }
+
+	GLuint internalFormat() const { return _internalFormat; }
 	
 	/// The framebuffer size (can be different from the default renderer size).
 	int _width;
@@ -41,7 +46,9 @@ private:
 
 	GLuint _id;
 	GLuint _idColor;
-	GLuint _idRenderbuffer;
+	GLuint _internalFormat;
+	GLuint _format;
+	GLuint _type;
 };
 
 #endif
@@ -0,0 +1,140 @@
+#include "GLState.h"
+
+const GLuint GLState::_unitsCount;
+const GLuint GLState::_unknown;
+
+bool GLState::_tracking = false;
+int GLState::_blendEnabled = -1;
+int GLState::_blendFunc = -1;
+int GLState::_cull = -1;
+GLuint GLState::_program = GLState::_unknown;
+GLuint GLState::_vao = GLState::_unknown;
+GLuint GLState::_activeUnit = GLState::_unknown;
+std::array<std::array<GLuint, 2>, GLState::_unitsCount> GLState::_textures;
+GLState::Stats GLState::_currentFrame;
+GLState::Stats GLState::_lastFrame;
+
+void GLState::beginFrame(){
+	_currentFrame = Stats();
+	_tracking = true;
+	// Other parts of the application (GUI, resources loading) can modify the state between frames.
+	_blendEnabled = -1;
+	_blendFunc = -1;
+	_cull = -1;
+	_program = _unknown;
+	_vao = _unknown;
+	_activeUnit = _unknown;
+	for(auto & unit : _textures){
+		unit.fill(_unknown);
+	}
+}
+
+void GLState::endFrame(){
+	// Leave a neutral state for the code outside of the frame.
+	useProgram(0);
+	bindVertexArray(0);
+	_lastFrame = _currentFrame;
+	_tracking = false;
+}
+
+bool GLState::changed(bool differs){
+	if(!_tracking){
+		return true;
+	}
+	if(differs){
+		++_currentFrame.issued;
+	} else {
+		++_currentFrame.skipped;
+	}
+	return differs;
+}
+
+void GLState::apply(const Setup & setup){
+	blend(setup.blend);
+	cullFace(setup.cull);
+}
+
+void GLState::blend(Blend mode){
+	const int enabled = mode == Blend::NONE ? 0 : 1;
+	if(changed(enabled != _blendEnabled)){
+		if(enabled){
+			glEnable(GL_BLEND);
+		} else {
+			glDisable(GL_BLEND);
+		}
+		_blendEnabled = enabled;
+	}
+	// Keep the current function when disabling blending.
+	if(!enabled){
+		return;
+	}
+	if(changed(int(mode) != _blendFunc)){
+		if(mode == Blend::ADDITIVE){
+			glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+		} else {
+			glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+		}
+		_blendFunc = int(mode);
+	}
+}
+
+void GLState::cullFace(bool enabled){
+	if(changed(int(enabled) != _cull)){
+		if(enabled){
+			glEnable(GL_CULL_FACE);
+		} else {
+			glDisable(GL_CULL_FACE);
+		}
+		_cull = int(enabled);
+	}
+}
+
+void GLState::useProgram(GLuint id){
+	if(changed(id != _program)){
+		glUseProgram(id);
+		_program = id;
+	}
+}
+
+void GLState::bindVertexArray(GLuint id){
+	if(changed(id != _vao)){
+		glBindVertexArray(id);
+		_vao = id;
+	}
+}
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint id){
+	const int targetId = target == GL_TEXTURE_2D ? 0 : (target == GL_TEXTURE_2D_ARRAY ? 1 : -1);
+	// Untracked units and targets are always bound.
+	if(unit >= _unitsCount || targetId < 0){
+		changed(true);
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, id);
+		_activeUnit = unit;
+		return;
+	}
+	if(!changed(_textures[unit][targetId] != id)){
+		return;
+	}
+	if(changed(_activeUnit != unit)){
+		glActiveTexture(GL_TEXTURE0 + unit);
+		_activeUnit = unit;
+	}
+	glBindTexture(target, id);
+	_textures[unit][targetId] = id;
+}
+
+void GLState::deleteTexture(GLuint id){
+	if(id == 0){
+		return;
+	}
+	glDeleteTextures(1, &id);
+	// Units it was bound to fall back to the default texture.
+	for(auto & unit : _textures){
+		for(GLuint & bound : unit){
+			if(bound == id){
+				bound = 0;
+			}
+		}
+	}
+}
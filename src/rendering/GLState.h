@@ -0,0 +1,81 @@
+#ifndef GLState_h
+#define GLState_h
+#include <gl3w/gl3w.h>
+#include <array>
+
+/// Cache of the GL state used by the render passes, skipping calls that would not change anything.
+/// The cache is only trusted between beginFrame and endFrame, outside of it calls are always issued
+/// so that setup code, the GUI and resources loading can keep using raw GL calls.
+class GLState {
+
+public:
+
+	/// Blending configurations used by the layers.
+	enum class Blend : int {
+		NONE = 0, ///< Disabled.
+		ALPHA, ///< Source alpha over destination.
+		ADDITIVE ///< Sum of source and destination.
+	};
+
+	/// Fixed-function state required by a draw.
+	struct Setup {
+		Blend blend;
+		bool cull;
+
+		Setup(Blend ablend = Blend::NONE, bool acull = true) : blend(ablend), cull(acull) {}
+	};
+
+	/// Number of GL calls issued or skipped over a frame.
+	struct Stats {
+		unsigned int issued = 0;
+		unsigned int skipped = 0;
+	};
+
+	/// Forget all cached values and start tracking calls for a new frame.
+	static void beginFrame();
+
+	/// Stop tracking, the counts are then available in lastFrame.
+	static void endFrame();
+
+	/// Apply the blending and culling of a setup.
+	static void apply(const Setup & setup);
+
+	static void blend(Blend mode);
+
+	static void cullFace(bool enabled);
+
+	static void useProgram(GLuint id);
+
+	static void bindVertexArray(GLuint id);
+
+	/// Bind a 2D or 2D array texture to the given texture unit.
+	static void bindTexture(GLuint unit, GLenum target, GLuint id);
+
+	/// Delete a texture, its name can be reused so it is also removed from the cached bindings.
+	static void deleteTexture(GLuint id);
+
+	/// Statistics of the last complete frame.
+	static const Stats & lastFrame(){ return _lastFrame; }
+
+private:
+
+	static bool changed(bool differs);
+
+	static bool _tracking;
+
+	static const GLuint _unitsCount = 4;
+	static const GLuint _unknown = 0xFFFFFFFF;
+
+	static int _blendEnabled;
+	static int _blendFunc;
+	static int _cull;
+	static GLuint _program;
+	static GLuint _vao;
+	static GLuint _activeUnit;
+	static std::array<std::array<GLuint, 2>, _unitsCount> _textures;
+
+	static Stats _currentFrame;
+	static Stats _lastFrame;
+};
+
+#endif
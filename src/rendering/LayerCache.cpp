@@ -0,0 +1,29 @@
+#include <cstring>
+
+#include "LayerCache.h"
+
+bool LayerCache::update(const glm::ivec2 & size, const unsigned char * key, size_t keySize){
+	if(!_framebuffer){
+		// Nearest filtering, the content is only copied or fetched texel by texel.
+		_framebuffer = std::shared_ptr<Framebuffer>(new Framebuffer(size[0], size[1], GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST, GL_CLAMP_TO_EDGE));
+		_valid = false;
+	} else if(_framebuffer->_width != size[0] || _framebuffer->_height != size[1]){
+		_framebuffer->resize(size[0], size[1]);
+		_valid = false;
+	}
+	if(_valid && _key.size() == keySize && std::memcmp(&_key[0], key, keySize) == 0){
+		return false;
+	}
+	_key.assign(key, key + keySize);
+	_valid = true;
+	return true;
+}
+
+void LayerCache::clean(){
+	if(_framebuffer){
+		_framebuffer->clean();
+		_framebuffer.reset();
+	}
+	_key.clear();
+	_valid = false;
+}
@@ -0,0 +1,40 @@
+#ifndef LayerCache_h
+#define LayerCache_h
+#include <gl3w/gl3w.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Framebuffer.h"
+
+/// Persistent target storing the result of layers that don't change every frame.
+/// Its content is tied to a key listing everything it depends on, and has to be rendered again when the key changes.
+class LayerCache {
+
+public:
+
+	/// Resize the target if needed and compare the key with the one of the current content.
+	/// Keys are compared bytewise, they should only contain 4-bytes fields to avoid padding.
+	/// \return true if the content is outdated and has to be rendered again
+	template<typename Key>
+	bool update(const glm::ivec2 & size, const Key & key){
+		return update(size, reinterpret_cast<const unsigned char *>(&key), sizeof(Key));
+	}
+
+	/// Force the content to be rendered again at the next update.
+	void invalidate(){ _valid = false; }
+
+	const std::shared_ptr<Framebuffer> & framebuffer() const { return _framebuffer; }
+
+	void clean();
+
+private:
+
+	bool update(const glm::ivec2 & size, const unsigned char * key, size_t keySize);
+
+	std::shared_ptr<Framebuffer> _framebuffer;
+	std::vector<unsigned char> _key;
+	bool _valid = false;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include <iostream>
+#include <algorithm>
+
+#include "../helpers/System.h"
+
+#include "Profiler.h"
+
+const size_t Profiler::historySize;
+const size_t Profiler::_framesInFlight;
+const size_t Profiler::_noSection;
+
+std::vector<Profiler::Section> Profiler::_sections;
+std::unordered_map<std::string, size_t> Profiler::_indices;
+std::vector<std::pair<size_t, double>> Profiler::_cpuStack;
+int Profiler::_gpuDepth = 0;
+size_t Profiler::_slot = 0;
+bool Profiler::_enabled = false;
+bool Profiler::_requested = false;
+bool Profiler::_inFrame = false;
+
+void Profiler::setEnabled(bool enabled){
+	_requested = enabled;
+	// CPU sections can be measured outside of frames.
+	if(!_inFrame){
+		_enabled = enabled;
+	}
+}
+
+void Profiler::beginFrame(){
+	_enabled = _requested;
+	if(!_enabled){
+		return;
+	}
+	_inFrame = true;
+	_gpuDepth = 0;
+	// Reuse the queries of the oldest frame in flight, after retrieving their results.
+	_slot = (_slot + 1) % _framesInFlight;
+	for(auto & section : _sections){
+		if(section.type != Type::GPU || section.used[_slot] == 0){
+			continue;
+		}
+		const std::vector<GLuint> & queries = section.queries[_slot];
+		const size_t used = section.used[_slot];
+		section.used[_slot] = 0;
+		// Queries complete in order, skip the sample if the last one is still pending.
+		GLint available = 0;
+		glGetQueryObjectiv(queries[used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(available == 0){
+			continue;
+		}
+		GLuint64 total = 0;
+		for(size_t qid = 0; qid < used; ++qid){
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(queries[qid], GL_QUERY_RESULT, &elapsed);
+			total += elapsed;
+		}
+		addSample(section, float(double(total) / 1000000.0));
+	}
+}
+
+void Profiler::endFrame(){
+	if(_gpuDepth > 0){
+		std::cerr << "[PROFILER]: Unbalanced GPU section." << std::endl;
+		_gpuDepth = 1;
+		endGPU();
+	}
+	_inFrame = false;
+	_enabled = _requested;
+}
+
+void Profiler::beginGPU(const std::string & name){
+	if(!_enabled || !_inFrame){
+		return;
+	}
+	++_gpuDepth;
+	if(_gpuDepth > 1){
+		return;
+	}
+	Section & current = section(name, Type::GPU);
+	std::vector<GLuint> & queries = current.queries[_slot];
+	size_t & used = current.used[_slot];
+	if(used == queries.size()){
+		queries.push_back(0);
+		glGenQueries(1, &queries.back());
+	}
+	glBeginQuery(GL_TIME_ELAPSED, queries[used]);
+	++used;
+}
+
+void Profiler::endGPU(){
+	if(!_enabled || !_inFrame || _gpuDepth == 0){
+		return;
+	}
+	--_gpuDepth;
+	if(_gpuDepth == 0){
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+}
+
+void Profiler::beginCPU(const std::string & name){
+	// Disabled scopes are still pushed, so that begin and end calls stay balanced.
+	size_t index = _noSection;
+	if(_enabled){
+		index = size_t(&section(name, Type::CPU) - &_sections[0]);
+	}
+	_cpuStack.emplace_back(index, System::time());
+}
+
+void Profiler::endCPU(){
+	if(_cpuStack.empty()){
+		return;
+	}
+	const auto & scope = _cpuStack.back();
+	if(scope.first != _noSection){
+		addSample(_sections[scope.first], float((System::time() - scope.second) * 1000.0));
+	}
+	_cpuStack.pop_back();
+}
+
+Profiler::Section & Profiler::section(const std::string & name, Type type){
+	const std::string key = (type == Type::GPU ? "G" : "C") + name;
+	const auto existing = _indices.find(key);
+	if(existing != _indices.end()){
+		return _sections[existing->second];
+	}
+	_indices[key] = _sections.size();
+	_sections.emplace_back();
+	Section & section = _sections.back();
+	section.name = name;
+	section.type = type;
+	section.history.fill(0.0f);
+	if(type == Type::GPU){
+		section.queries.resize(_framesInFlight);
+		section.used.resize(_framesInFlight, 0);
+	}
+	return section;
+}
+
+void Profiler::addSample(Section & section, float duration){
+	section.history[section.next] = duration;
+	section.next = (section.next + 1) % historySize;
+	section.count = (std::min)(section.count + 1, historySize);
+	section.last = duration;
+}
+
+bool Profiler::saveCSV(const std::string & path){
+	std::ofstream file = System::openOutputFile(path);
+	if(!file.is_open()){
+		std::cerr << "[PROFILER]: Unable to write timings to " << path << "." << std::endl;
+		return false;
+	}
+	file << "section,type,sample,milliseconds" << "\n";
+	for(const auto & section : _sections){
+		const std::string type = section.type == Type::GPU ? "GPU" : "CPU";
+		// Oldest samples first.
+		const size_t first = (section.next + historySize - section.count) % historySize;
+		for(size_t sid = 0; sid < section.count; ++sid){
+			file << "\"" << section.name << "\"," << type << "," << sid << "," << section.history[(first + sid) % historySize] << "\n";
+		}
+	}
+	file.close();
+	return true;
+}
+
+void Profiler::clean(){
+	for(auto & section : _sections){
+		for(auto & queries : section.queries){
+			if(!queries.empty()){
+				glDeleteQueries(GLsizei(queries.size()), &queries[0]);
+			}
+		}
+	}
+	_sections.clear();
+	_indices.clear();
+	_cpuStack.clear();
+	_gpuDepth = 0;
+}
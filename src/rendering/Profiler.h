@@ -0,0 +1,82 @@
+#ifndef Profiler_h
+#define Profiler_h
+#include <gl3w/gl3w.h>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Timings of the sections of a frame, measured with a timer on the CPU and with elapsed time queries on the GPU.
+/// GPU results are read back a few frames later to avoid stalling the pipeline.
+/// GPU sections can't overlap: a section started inside another one is measured as part of it.
+/// A section measured several times in a frame reports the sum of its durations.
+class Profiler {
+
+public:
+
+	enum class Type : int {
+		CPU = 0, GPU
+	};
+
+	static const size_t historySize = 120;
+
+	struct Section {
+		std::string name;
+		Type type = Type::CPU;
+		std::array<float, historySize> history; ///< Durations in milliseconds, as a ring buffer.
+		size_t next = 0; ///< Position of the next sample, the oldest one once the history is full.
+		size_t count = 0; ///< Number of valid samples.
+		float last = 0.0f;
+
+		// GPU queries, per frame in flight.
+		std::vector<std::vector<GLuint>> queries;
+		std::vector<size_t> used;
+	};
+
+	/// Enable or disable measurements, effective from the next frame.
+	static void setEnabled(bool enabled);
+
+	static bool enabled(){ return _enabled; }
+
+	/// Start a frame, retrieving the GPU timings of an earlier one.
+	static void beginFrame();
+
+	static void endFrame();
+
+	static void beginGPU(const std::string & name);
+
+	static void endGPU();
+
+	static void beginCPU(const std::string & name);
+
+	static void endCPU();
+
+	/// All sections measured so far, in order of first appearance.
+	static const std::vector<Section> & sections(){ return _sections; }
+
+	/// Write the recorded history of all sections to a CSV file.
+	static bool saveCSV(const std::string & path);
+
+	/// Clean function
+	static void clean();
+
+private:
+
+	static Section & section(const std::string & name, Type type);
+
+	static void addSample(Section & section, float duration);
+
+	static const size_t _framesInFlight = 3;
+	static const size_t _noSection = size_t(-1);
+
+	static std::vector<Section> _sections;
+	static std::unordered_map<std::string, size_t> _indices;
+	static std::vector<std::pair<size_t, double>> _cpuStack;
+	static int _gpuDepth;
+	static size_t _slot;
+	static bool _enabled;
+	static bool _requested;
+	static bool _inFrame;
+};
+
+#endif
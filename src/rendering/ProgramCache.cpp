@@ -0,0 +1,127 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+
+#include "../helpers/ProgramUtilities.h"
+#include "../helpers/System.h"
+
+#include "ProgramCache.h"
+
+// Identify cache files, bump the version if the layout changes.
+static const uint32_t cacheMagic = 0x4250564D; // "MVPB"
+static const uint32_t cacheVersion = 1;
+
+std::string ProgramCache::_directory = "";
+std::string ProgramCache::_driver = "";
+bool ProgramCache::_enabled = false;
+
+void ProgramCache::init(const std::string & directory){
+	_enabled = false;
+	// Program binaries are only available with GL 4.1 or ARB_get_program_binary.
+	if(!glGetProgramBinary || !glProgramBinary || !glProgramParameteri){
+		return;
+	}
+	GLint formatsCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsCount);
+	checkGLError();
+	if(formatsCount <= 0 || directory.empty()){
+		return;
+	}
+	// Binaries are only valid for the driver that produced them.
+	const GLubyte * vendor = glGetString(GL_VENDOR);
+	const GLubyte * renderer = glGetString(GL_RENDERER);
+	const GLubyte * version = glGetString(GL_VERSION);
+	_driver = "";
+	for(const GLubyte * str : { vendor, renderer, version }){
+		_driver.append(str ? reinterpret_cast<const char*>(str) : "");
+		_driver.push_back('\n');
+	}
+	// The directory might already exist.
+	System::createDirectory(directory);
+	_directory = directory;
+	_enabled = true;
+}
+
+GLuint ProgramCache::program(const std::string & vertexContent, const std::string & fragmentContent){
+	if(!_enabled){
+		return createGLProgramFromStrings(vertexContent, fragmentContent);
+	}
+
+	uint64_t hash = System::hash(_driver);
+	hash = System::hash(vertexContent, hash);
+	// Separate the two stages so that moving code between them changes the key.
+	hash = System::hash(std::string(1, '\0'), hash);
+	hash = System::hash(fragmentContent, hash);
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+	const std::string path = _directory + name;
+
+	const GLuint cached = loadBinary(path);
+	if(cached != 0){
+		return cached;
+	}
+	const GLuint id = createGLProgramFromStrings(vertexContent, fragmentContent);
+	if(id != 0){
+		saveBinary(id, path);
+	}
+	return id;
+}
+
+GLuint ProgramCache::loadBinary(const std::string & path){
+	std::ifstream file = System::openInputFile(path, true);
+	if(!file.is_open()){
+		return 0;
+	}
+	uint32_t header[3] = {0, 0, 0};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if(!file || header[0] != cacheMagic || header[1] != cacheVersion){
+		return 0;
+	}
+	const GLenum format = GLenum(header[2]);
+	const std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	if(binary.empty()){
+		return 0;
+	}
+
+	const GLuint id = glCreateProgram();
+	glProgramBinary(id, format, binary.data(), GLsizei(binary.size()));
+	// The driver can reject a binary at any time (update, different settings), recompile then.
+	GLint success = GL_FALSE;
+	glGetProgramiv(id, GL_LINK_STATUS, &success);
+	// Clear errors caused by an unsupported format.
+	while(glGetError() != GL_NO_ERROR){}
+	if(!success){
+		glDeleteProgram(id);
+		return 0;
+	}
+	return id;
+}
+
+void ProgramCache::saveBinary(GLuint id, const std::string & path){
+	GLint length = 0;
+	glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0){
+		return;
+	}
+	std::vector<char> binary(length);
+	GLenum format = GL_NONE;
+	GLsizei written = 0;
+	glGetProgramBinary(id, length, &written, &format, binary.data());
+	checkGLError();
+	if(written <= 0){
+		return;
+	}
+
+	std::ofstream file = System::openOutputFile(path, true);
+	if(!file.is_open()){
+		std::cerr << "[GL]: Unable to write program cache file " << path << "." << std::endl;
+		return;
+	}
+	const uint32_t header[3] = { cacheMagic, cacheVersion, uint32_t(format) };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(binary.data(), written);
+	file.close();
+}
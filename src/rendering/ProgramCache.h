@@ -0,0 +1,30 @@
+#ifndef ProgramCache_h
+#define ProgramCache_h
+#include <gl3w/gl3w.h>
+#include <string>
+
+/// On-disk cache of linked program binaries, to skip shaders compilation at startup.
+/// Entries are keyed by the shaders source and the GL driver, any failure falls back to compiling.
+class ProgramCache {
+
+public:
+
+	/// Enable the cache, storing binaries in the given directory (created if needed).
+	/// Has to be called once a GL context is current.
+	static void init(const std::string & directory);
+
+	/// Load a linked program from the cache, or compile it and store its binary.
+	static GLuint program(const std::string & vertexContent, const std::string & fragmentContent);
+
+private:
+
+	static GLuint loadBinary(const std::string & path);
+
+	static void saveBinary(GLuint id, const std::string & path);
+
+	static std::string _directory;
+	static std::string _driver;
+	static bool _enabled;
+};
+
+#endif
@@ -5,7 +5,10 @@
 #include "../helpers/ResourcesManager.h"
 #include "../helpers/ImGuiStyle.h"
 #include "../helpers/System.h"
+#include "../helpers/Trace.h"
 #include <cstring>
+#include <cmath>
+#include <cfloat>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui/imgui.h>
 #include <iostream>
@@ -14,12 +17,14 @@
 #include <vector>
 
 #include "Renderer.h"
+#include "Profiler.h"
 #include "scene/MIDIScene.h"
 #include "scene/MIDISceneFile.h"
 #include "scene/MIDISceneLive.h"
 
 #include <algorithm>
 #include <fstream>
+#include <sstream>
 
 #include "../libs/miniaudio.h"
 
@@ -45,6 +50,7 @@ Renderer::Renderer(const Configuration& config) :
 	_showDebug = false;
 
 	_fullscreen = config.fullscreen;
+	_headless = config.headless;
 	_windowSize = config.windowSize;
 	_useTransparency = config.useTransparency && _supportTransparency;
 
@@ -65,21 +71,30 @@ Renderer::Renderer(const Configuration& config) :
 
 	// Setup framebuffers, size does not really matter as we expect a resize event just after.
 	const glm::ivec2 renderSize = _camera.renderSize();
-	_particlesFramebuffer = std::shared_ptr<Framebuffer>(new Framebuffer(renderSize[0], renderSize[1],
-		GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE));
-	_blurFramebuffer0 = std::shared_ptr<Framebuffer>(new Framebuffer(renderSize[0], renderSize[1],
-		GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE));
-	_blurFramebuffer1 = std::shared_ptr<Framebuffer>(new Framebuffer(renderSize[0], renderSize[1],
-		GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE));
-	_renderFramebuffer = std::shared_ptr<Framebuffer>(new Framebuffer(renderSize[0], renderSize[1],
-	GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE));
+	// The blur history is kept in half floats, so that it fades out completely instead of stalling on 8-bit steps.
+	_blurFramebuffer = std::shared_ptr<Framebuffer>(new Framebuffer(renderSize[0], renderSize[1],
+		GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_LINEAR, GL_CLAMP_TO_EDGE));
 	_finalFramebuffer = std::shared_ptr<Framebuffer>(new Framebuffer(renderSize[0], renderSize[1],
 		GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE));
 
+	// Uniform blocks shared by all programs.
+	_frameUniforms.init(UniformBlock::FRAME);
+	_sceneUniforms.init(UniformBlock::SCENE);
+	_paletteUniforms.init(UniformBlock::PALETTE);
+
 	_backgroundTexture.init("backgroundtexture_frag", "backgroundtexture_vert");
-	_blurringScreen.init(_particlesFramebuffer->textureId(), "particlesblur_frag");
+	_blurDownsample.init("particlesblurdown_frag");
+	_blurUpsample.init("particlesblurup_frag");
 	_fxaa.init("fxaa_frag");
 	_passthrough.init("screenquad_frag");
+	_scrollingCache.init("scrollingcache_frag");
+	_blurDownsampleUniforms.offset = _blurDownsample.program().registerUniform("offset");
+	_blurDownsampleUniforms.lastLevel = _blurDownsample.program().registerUniform("lastLevel");
+	_blurUpsampleUniforms.offset = _blurUpsample.program().registerUniform("offset");
+	_blurUpsampleUniforms.lastLevel = _blurUpsample.program().registerUniform("lastLevel");
+	_backgroundAlphaUniform = _backgroundTexture.program().registerUniform("textureAlpha");
+	_backgroundBehindKeyboardUniform = _backgroundTexture.program().registerUniform("behindKeyboard");
+	_scoreCacheOffsetUniform = _scrollingCache.program().registerUniform("offset");
 
 	// Create the layers.
 	//_layers[Layer::BGCOLOR].type = Layer::BGCOLOR;
@@ -122,6 +137,17 @@ Renderer::Renderer(const Configuration& config) :
 	_layers[Layer::WAVE].name = "Waves";
 	_layers[Layer::WAVE].draw = &Renderer::drawWaves;
 
+	// Blending and culling required by each layer.
+	_layers[Layer::BGTEXTURE].state = GLState::Setup(GLState::Blend::ALPHA);
+	_layers[Layer::BLUR].state = GLState::Setup(GLState::Blend::ALPHA);
+	_layers[Layer::ANNOTATIONS].state = GLState::Setup(GLState::Blend::ALPHA);
+	_layers[Layer::KEYBOARD].state = GLState::Setup(GLState::Blend::NONE);
+	_layers[Layer::PARTICLES].state = GLState::Setup(GLState::Blend::ALPHA);
+	_layers[Layer::NOTES].state = GLState::Setup(GLState::Blend::ALPHA);
+	_layers[Layer::FLASHES].state = GLState::Setup(GLState::Blend::ADDITIVE);
+	_layers[Layer::PEDAL].state = GLState::Setup(GLState::Blend::ALPHA, false);
+	_layers[Layer::WAVE].state = GLState::Setup(GLState::Blend::ADDITIVE);
+
 	// Register state.
 	_layers[Layer::BGTEXTURE].toggle = &_state.background.image;
 	_layers[Layer::BLUR].toggle = &_state.showBlur;
@@ -133,6 +159,9 @@ Renderer::Renderer(const Configuration& config) :
 	_layers[Layer::PEDAL].toggle = &_state.showPedal;
 	_layers[Layer::WAVE].toggle = &_state.showWave;
 
+	// The background image can be composited once with the background color.
+	_layers[Layer::BGTEXTURE].constant = true;
+
 	// Check setup errors.
 	checkGLError();
 
@@ -242,134 +271,426 @@ SystemAction Renderer::draw(float currentTime) {
 		drawScene(_recorder.isTransparent());
 
 		_recorder.record(_finalFramebuffer);
-		_recorder.drawProgress();
+		if(!_headless){
+			_recorder.drawProgress();
+		}
 
 		// Determine which system action to take.
 		SystemAction action = SystemAction::NONE;
-		// Look at the frame ID.
-		if(_recorder.currentFrame() < 2){
-			action = SystemAction::FIX_SIZE;
-		} else if(_recorder.currentFrame() >= _recorder.framesCount()){
+		// Look at the frame ID, the export can end after its first frame.
+		if(_recorder.currentFrame() >= _recorder.framesCount()){
 			action = _exitAfterRecording ? SystemAction::QUIT : SystemAction::FREE_SIZE;
 			_timer = 0.0f;
 			_timerStart = 0.0f;
 			_shouldPlay = false;
 			resize(_backbufferSize[0], _backbufferSize[1]);
+		} else if(_recorder.currentFrame() < 2){
+			action = SystemAction::FIX_SIZE;
 		}
 		// Make sure the backbuffer is updated, this is nicer.
-		glViewport(0, 0, GLsizei(_backbufferSize[0]), GLsizei(_backbufferSize[1]));
-		_passthrough.draw(_finalFramebuffer->textureId(), _timer);
+		if(!_headless){
+			glViewport(0, 0, GLsizei(_backbufferSize[0]), GLsizei(_backbufferSize[1]));
+			_passthrough.draw(_finalFramebuffer->textureId(), _timer);
+		}
 		return action;
 	}
 
 	// -- Default mode --
 
+	// Only measure timings when they are displayed.
+	Profiler::setEnabled(_showGUI && _showDebug);
+
 	// Compute the time elapsed since last frame, or keep the same value if
 	// playback is disabled.
 	_timer = _shouldPlay ? (currentTime - _timerStart) : _timer;
 
-	// Render scene and blit, with GUI on top if needed.
-	drawScene(_useTransparency);
+	// Only render the scene if something changed, else re-present the last frame.
+	const bool damaged = _timer != _lastDrawnTimer || _liveplay || _redrawFrames > 0;
+	if(damaged){
+		_settleFrames = _state.showBlur ? blurSettleFrames() : 0;
+		_redrawFrames = (std::max)(_redrawFrames - 1, 0);
+		_lastDrawnTimer = _timer;
+		_skippedFrames = 0;
+		drawScene(_useTransparency);
+	} else if(_settleFrames > 0){
+		--_settleFrames;
+		drawScene(_useTransparency);
+	} else {
+		++_skippedFrames;
+	}
 
 	glViewport(0, 0, GLsizei(_backbufferSize[0]), GLsizei(_backbufferSize[1]));
 	_passthrough.draw(_finalFramebuffer->textureId(), _timer);
 
 	SystemAction action = SystemAction::NONE;
 	if(_showGUI){
+		TRACE_SCOPE("GUI");
+		Profiler::beginCPU("GUI");
 		action = drawGUI(currentTime);
+		Profiler::endCPU();
 	}
 
 	return action;
 }
 
+void Renderer::requestRedraw(){
+	// A few frames to let the GUI apply and display changes.
+	_redrawFrames = (std::max)(_redrawFrames, 3);
+}
+
+bool Renderer::isIdle() const {
+	if(_recorder.isRecording() || _shouldPlay || _liveplay){
+		return false;
+	}
+	// Keep the text cursor blinking.
+	if(_showGUI && ImGui::GetIO().WantTextInput){
+		return false;
+	}
+	return _redrawFrames == 0 && _settleFrames == 0;
+}
+
+int Renderer::blurSettleFrames() const {
+	// Each frame the previous blur is attenuated (twice, see particlesblurup), wait until the residual is below half a 8-bit step.
+	const float attenuation = _state.attenuation * _state.attenuation;
+	if(attenuation <= 0.0f){
+		return 1;
+	}
+	if(attenuation >= 1.0f){
+		// No fading, the spreading alone converges slowly.
+		return 1200;
+	}
+	const float frames = std::ceil(std::log(0.5f / 255.0f) / std::log(attenuation));
+	return (std::min)(int(frames), 1200);
+}
+
 void Renderer::drawScene(bool transparentBG){
+	TRACE_SCOPE("Draw scene");
+
+	GLState::beginFrame();
+	Profiler::beginFrame();
 
 	// Update active notes listing (for particles).
-	_scene->updatesActiveNotes(_state.scrollSpeed * _timer, _state.scrollSpeed);
+	Profiler::beginCPU("Active notes");
+	{
+		TRACE_SCOPE("updatesActiveNotes");
+		_scene->updatesActiveNotes(_state.scrollSpeed * _timer, _state.scrollSpeed);
+	}
+	Profiler::endCPU();
+
+	// Settings shared by all programs, uploaded only if they changed.
+	updateUniformBuffers();
+	updateShaderFeatures();
 
-	const glm::vec2 invSizeFb = 1.0f / glm::vec2(_renderFramebuffer->_width, _renderFramebuffer->_height);
+	// Describe the passes of the frame, intermediate targets are allocated and shared by the graph.
+	// Only the blur history and the final result are kept between frames.
+	_frameGraph.reset();
+	const FrameGraph::Target blurTarget = _frameGraph.import("Blur", _blurFramebuffer);
+	const FrameGraph::Target finalTarget = _frameGraph.import("Final", _finalFramebuffer);
+	const FrameGraph::Target renderTarget = _frameGraph.create("Render", glm::ivec2(_finalFramebuffer->_width, _finalFramebuffer->_height));
 
 	// Blur rendering.
 	if (_state.showBlur) {
-		blurPrepass();
+		addBlurPasses(blurTarget);
 	}
 
-	// Set viewport
-	_renderFramebuffer->bind();
-	glViewport(0, 0, _renderFramebuffer->_width, _renderFramebuffer->_height);
+	_frameGraph.addPass("Layers", {blurTarget}, {renderTarget}, [this, renderTarget, transparentBG](){
+		drawLayers(_frameGraph.framebuffer(renderTarget), transparentBG);
+	});
+
+	// Apply fxaa.
+	if(_state.applyAA){
+		_frameGraph.addPass("FXAA", {renderTarget}, {finalTarget}, [this, renderTarget, finalTarget](){
+			const std::shared_ptr<Framebuffer> & src = _frameGraph.framebuffer(renderTarget);
+			const std::shared_ptr<Framebuffer> & dst = _frameGraph.framebuffer(finalTarget);
+			Profiler::beginGPU("FXAA");
+			glViewport(0, 0, dst->_width, dst->_height);
+			dst->bind();
+			_fxaa.draw(src->textureId(), 0.0, 1.0f / glm::vec2(src->_width, src->_height));
+			dst->unbind();
+			Profiler::endGPU();
+		});
+	} else {
+		// Else just do a copy, skipped by rendering the layers directly in the final target.
+		_frameGraph.addCopy("Copy", renderTarget, finalTarget);
+	}
+
+	_frameGraph.execute();
+
+	Profiler::endFrame();
+	GLState::endFrame();
+
+}
+
+void Renderer::drawLayers(const std::shared_ptr<Framebuffer> & target, bool transparentBG){
+	const glm::ivec2 size(target->_width, target->_height);
+	const glm::vec2 invSizeFb = 1.0f / glm::vec2(size);
+	updateFrameUniforms(invSizeFb);
+
+	if(_state.showScore){
+		updateScoreCache(size, invSizeFb);
+	}
 
-	// Final pass (directly on screen).
 	// Background color.
-	if(transparentBG){
-		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	const glm::vec4 clearColor = transparentBG ? glm::vec4(0.0f) : glm::vec4(_state.background.color, 1.0f);
+
+	// Find the constant layers at the bottom of the layers order, they only have to be rendered when settings change.
+	size_t firstLayer = 0;
+	bool hasConstantLayers = false;
+	for(; firstLayer < _state.layersMap.size(); ++firstLayer){
+		const int layerId = _state.layersMap[firstLayer];
+		if(layerId >= _layers.size() || !_layers[layerId].draw || !*(_layers[layerId].toggle)){
+			continue;
+		}
+		if(!_layers[layerId].constant){
+			break;
+		}
+		hasConstantLayers = true;
+	}
+
+	if(hasConstantLayers){
+		// Everything the background color and image depend on.
+		struct ConstantLayersKey {
+			glm::vec4 clearColor;
+			unsigned int layers[Layer::COUNT];
+			GLuint imageTexture;
+			float imageAlpha;
+			int imageBehindKeyboard;
+			float keyboardHeight;
+		} key;
+		key.clearColor = clearColor;
+		for(size_t lid = 0; lid < Layer::COUNT; ++lid){
+			key.layers[lid] = lid < firstLayer ? (unsigned int)(_state.layersMap[lid]) : Layer::COUNT;
+		}
+		key.imageTexture = _state.background.tex;
+		key.imageAlpha = _state.background.imageAlpha;
+		key.imageBehindKeyboard = _state.background.imageBehindKeyboard ? 1 : 0;
+		key.keyboardHeight = _state.keyboard.size;
+
+		const std::shared_ptr<Framebuffer> & cache = _constantLayers.framebuffer();
+		if(_constantLayers.update(size, key)){
+			cache->bind();
+			glViewport(0, 0, size[0], size[1]);
+			glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+			glClear(GL_COLOR_BUFFER_BIT);
+			drawLayersRange(0, firstLayer, invSizeFb);
+			cache->unbind();
+		}
+		// Replace the clear and the constant layers by a copy.
+		Profiler::beginGPU("Constant layers");
+		_constantLayers.framebuffer()->bind(GL_READ_FRAMEBUFFER);
+		target->bind(GL_DRAW_FRAMEBUFFER);
+		glBlitFramebuffer(0, 0, size[0], size[1], 0, 0, size[0], size[1], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		Profiler::endGPU();
 	} else {
-		glClearColor(_state.background.color[0], _state.background.color[1], _state.background.color[2], 1.0f);
+		firstLayer = 0;
 	}
 
-	glClear(GL_COLOR_BUFFER_BIT);
+	// Set viewport
+	target->bind();
+	glViewport(0, 0, size[0], size[1]);
+
+	if(!hasConstantLayers){
+		glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	// Draw the remaining layers in order.
+	drawLayersRange(firstLayer, _state.layersMap.size(), invSizeFb);
+
+	target->unbind();
+	GLState::apply(GLState::Setup());
+}
 
-	// Draw the layers in order.
-	for (int i = 0; i < _state.layersMap.size(); ++i) {
+void Renderer::drawLayersRange(size_t first, size_t last, const glm::vec2 & invSize){
+	for (size_t i = first; i < last; ++i) {
 		const int layerId = _state.layersMap[i];
 		if (layerId >= _layers.size()) {
 			continue;
 		}
 		if (_layers[layerId].draw && *(_layers[layerId].toggle)) {
-			(this->*_layers[layerId].draw)(invSizeFb);
+			TRACE_SCOPE(_layers[layerId].name.c_str());
+			Profiler::beginGPU(_layers[layerId].name);
+			GLState::apply(_layers[layerId].state);
+			(this->*_layers[layerId].draw)(invSize);
+			Profiler::endGPU();
 		}
 	}
+}
 
-	_renderFramebuffer->unbind();
+void Renderer::updateScoreCache(const glm::ivec2 & screenSize, const glm::vec2 & invSize){
+	// The score only scrolls over time, render it once over the screen and a margin along the scrolling axis,
+	// then offset it by whole pixels until the margin is exhausted.
+	const int axis = _state.horizontalScroll ? 0 : 1;
+	const int margin = (std::max)(1, screenSize[axis] / 2);
+	glm::ivec2 cacheSize = screenSize;
+	cacheSize[axis] += margin;
+
+	// Everything the score depends on, except the scroll time.
+	struct ScoreKey {
+		SceneUniforms scene;
+		glm::ivec2 screenSize;
+		unsigned int features;
+		glm::vec3 linesColor;
+		glm::vec3 textColor;
+		float secondsPerMeasure;
+	} key;
+	key.scene = _sceneUniforms.data();
+	key.screenSize = screenSize;
+	key.features = _score->program().features();
+	key.linesColor = _state.background.linesColor;
+	key.textColor = _state.background.textColor;
+	key.secondsPerMeasure = float(_scene->secondsPerMeasure());
+
+	// The score scrolls by whole pixels, so that the cache is only ever shifted by whole pixels.
+	const float scrollTime = _timer * _state.scrollSpeed;
+	const float pixelsPerSecond = 0.5f * _state.scale * float(screenSize[axis]);
+	const int scrolled = int(std::floor(scrollTime * pixelsPerSecond + 0.5f));
+	// The cache is rendered at positions on a fixed grid, so that each frame only depends on its time.
+	const int origin = int(std::floor(float(scrolled) / float(margin))) * margin;
+	const int shift = scrolled - origin;
+
+	const bool outdated = _scoreLayer.update(cacheSize, key);
+	if(outdated || origin != _scoreCacheOrigin){
+		TRACE_SCOPE("Score cache");
+		const float cacheTime = float(double(origin) / double(pixelsPerSecond));
+		_frameUniforms.data().scrollTime = cacheTime;
+		_frameUniforms.upload();
+
+		const std::shared_ptr<Framebuffer> & cache = _scoreLayer.framebuffer();
+		cache->bind();
+		glViewport(0, 0, cacheSize[0], cacheSize[1]);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		// Store the score as is, it will be blended when compositing the cache.
+		GLState::apply(GLState::Setup());
+		// Extend the range covered by the score in the direction notes are coming from.
+		const float extent = float(margin) / float(screenSize[axis]);
+		_score->setUVRange(_state.reverseScroll ? glm::vec2(-extent, 1.0f) : glm::vec2(0.0f, 1.0f + extent));
+		_score->draw(cacheTime, invSize);
+		cache->unbind();
+		_scoreCacheOrigin = origin;
+
+		_frameUniforms.data().scrollTime = scrollTime;
+		_frameUniforms.upload();
+	}
+	// The content scrolls towards the keyboard.
+	const float offset = float(_state.reverseScroll ? margin - shift : shift);
+	_scoreCacheOffset = axis == 0 ? glm::vec2(offset, 0.0f) : glm::vec2(0.0f, offset);
+}
 
-	// Apply fxaa.
-	if(_state.applyAA){
-		_finalFramebuffer->bind();
-		_fxaa.draw(_renderFramebuffer->textureId(), 0.0, invSizeFb);
-		_finalFramebuffer->unbind();
-	} else {
-		// Else just do a blit.
-		_renderFramebuffer->bind(GL_READ_FRAMEBUFFER);
-		_finalFramebuffer->bind(GL_DRAW_FRAMEBUFFER);
-		glBlitFramebuffer(0, 0, _renderFramebuffer->_width, _renderFramebuffer->_height, 0, 0, _finalFramebuffer->_width, _finalFramebuffer->_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-		_finalFramebuffer->unbind();
+void Renderer::addBlurPasses(FrameGraph::Target blurTarget) {
+	const FrameGraph::Target particlesTarget = _frameGraph.create("Particles", _particlesSize, GL_RGBA16F);
+
+	_frameGraph.addPass("Particles", {blurTarget}, {particlesTarget}, [this, blurTarget, particlesTarget](){
+		TRACE_SCOPE("Blur prepass");
+		Profiler::beginGPU("Blur prepass");
+		const std::shared_ptr<Framebuffer> & particlesFramebuffer = _frameGraph.framebuffer(particlesTarget);
+		const glm::vec2 invSizeB = 1.0f / glm::vec2(particlesFramebuffer->_width, particlesFramebuffer->_height);
+		updateFrameUniforms(invSizeB);
+		// Bind particles buffer.
+		particlesFramebuffer->bind();
+		// Set viewport.
+		glViewport(0, 0, particlesFramebuffer->_width, particlesFramebuffer->_height);
+		// Draw blurred particles from previous frames.
+		GLState::apply(GLState::Setup());
+		_passthrough.draw(_frameGraph.framebuffer(blurTarget)->textureId(), _timer);
+		if (_state.showParticles) {
+			// Draw the new particles.
+			GLState::apply(GLState::Setup(GLState::Blend::ALPHA));
+			_scene->drawParticles(_state.particles, true);
+		}
+		if (_state.showBlurNotes) {
+			// Draw the notes.
+			GLState::apply(GLState::Setup());
+			_scene->drawNotes(true);
+		}
+
+		particlesFramebuffer->unbind();
+		GLState::apply(GLState::Setup());
+		Profiler::endGPU();
+	});
+
+	// Perform blur on result from particles pass, by progressively downsampling it then upsampling it back.
+	const int levelsCount = int(_blurLevelsSizes.size());
+	// Keep the spread of the blur similar whatever the number of levels.
+	const float offset = 2.0f / float(1 << (levelsCount - 1));
+	std::vector<FrameGraph::Target> levels(levelsCount);
+	FrameGraph::Target src = particlesTarget;
+	for(int lid = 0; lid < levelsCount; ++lid){
+		const FrameGraph::Target dst = _frameGraph.create("Blur level", _blurLevelsSizes[lid], GL_RGBA16F);
+		_frameGraph.addPass("Blur downsample", {src}, {dst}, [this, src, dst, offset](){
+			drawBlurLevel(_blurDownsample, _blurDownsampleUniforms, src, dst, offset, false);
+		});
+		levels[lid] = dst;
+		src = dst;
+	}
+	for(int lid = levelsCount - 2; lid >= -1; --lid){
+		// The last upsampling writes the result and applies the fading.
+		const FrameGraph::Target dst = lid >= 0 ? levels[lid] : blurTarget;
+		_frameGraph.addPass("Blur upsample", {src}, {dst}, [this, src, dst, offset, lid](){
+			drawBlurLevel(_blurUpsample, _blurUpsampleUniforms, src, dst, offset, lid < 0);
+		});
+		src = dst;
 	}
 
 }
 
-void Renderer::blurPrepass() {
-	const glm::vec2 invSizeB = 1.0f / glm::vec2(_particlesFramebuffer->_width, _particlesFramebuffer->_height);
-	// Bind particles buffer.
-	_particlesFramebuffer->bind();
-	// Set viewport.
-	glViewport(0, 0, _particlesFramebuffer->_width, _particlesFramebuffer->_height);
-	// Draw blurred particles from previous frames.
-	_passthrough.draw(_blurFramebuffer1->textureId(), _timer);
-	if (_state.showParticles) {
-		// Draw the new particles.
-		_scene->drawParticles(_timer, invSizeB, _state.particles, true);
-	}
-	if (_state.showBlurNotes) {
-		// Draw the notes.
-		_scene->drawNotes(_timer, invSizeB, _state.baseColors, _state.minorColors, _state.reverseScroll, true);
-	}
+void Renderer::drawBlurLevel(ScreenQuad & pass, const BlurUniforms & uniforms, FrameGraph::Target src, FrameGraph::Target dst, float offset, bool lastLevel){
+	const std::shared_ptr<Framebuffer> & srcFramebuffer = _frameGraph.framebuffer(src);
+	const std::shared_ptr<Framebuffer> & dstFramebuffer = _frameGraph.framebuffer(dst);
+	// All levels are accumulated with the particles pass.
+	Profiler::beginGPU("Blur prepass");
+	pass.program().use();
+	pass.program().uniform(uniforms.offset, offset);
+	pass.program().uniform(uniforms.lastLevel, lastLevel);
+	glViewport(0, 0, dstFramebuffer->_width, dstFramebuffer->_height);
+	dstFramebuffer->bind();
+	pass.draw(srcFramebuffer->textureId(), 0.0f, 1.0f / glm::vec2(srcFramebuffer->_width, srcFramebuffer->_height));
+	dstFramebuffer->unbind();
+	Profiler::endGPU();
+}
 
-	_particlesFramebuffer->unbind();
+void Renderer::updateUniformBuffers(){
+	SceneUniforms & scene = _sceneUniforms.data();
+	scene.keyboardHeight = _state.keyboard.size;
+	scene.mainSpeed = _state.scale;
+	scene.minorsWidth = _state.background.minorsWidth;
+	scene.fadeOut = _state.keyboard.size + (1.0f - _state.keyboard.size) * (1.0f - _state.notesFadeOut);
+	_sceneUniforms.upload();
+
+	const ColorArray & keysMajor = _state.keyboard.customKeyColors ? _state.keyboard.majorColor : _state.baseColors;
+	const ColorArray & keysMinor = _state.keyboard.customKeyColors ? _state.keyboard.minorColor : _state.minorColors;
+	PaletteUniforms & palette = _paletteUniforms.data();
+	for(size_t cid = 0; cid < SETS_COUNT; ++cid){
+		palette.notesMajor[cid] = glm::vec4(_state.baseColors[cid], 1.0f);
+		palette.notesMinor[cid] = glm::vec4(_state.minorColors[cid], 1.0f);
+		palette.flashes[cid] = glm::vec4(_state.flashColors[cid], 1.0f);
+		palette.particles[cid] = glm::vec4(_state.particles.colors[cid], 1.0f);
+		palette.keysMajor[cid] = glm::vec4(keysMajor[cid], 1.0f);
+		palette.keysMinor[cid] = glm::vec4(keysMinor[cid], 1.0f);
+	}
+	_paletteUniforms.upload();
+}
 
-	// Perform blur on result from particles pass.
-	// We re-use the 'time' uniform to denote if this is the vertical or horizontal pass.
-	// Horizontal pass
-	const glm::vec2 invBlurSize0 = 1.0f / glm::vec2(_particlesFramebuffer->_width, _particlesFramebuffer->_height);
-	glViewport(0, 0, _blurFramebuffer0->_width, _blurFramebuffer0->_height);
-	_blurFramebuffer0->bind();
-	_blurringScreen.draw(_particlesFramebuffer->textureId(), 0.0f, invBlurSize0);
-	_blurFramebuffer0->unbind();
-	// Vertical pass
-	const glm::vec2 invBlurSize1 = 1.0f / glm::vec2(_blurFramebuffer0->_width, _blurFramebuffer0->_height);
-	glViewport(0, 0, _blurFramebuffer1->_width, _blurFramebuffer1->_height);
-	_blurFramebuffer1->bind();
-	_blurringScreen.draw(_blurFramebuffer0->textureId(), 1.0f, invBlurSize1);
-	_blurFramebuffer1->unbind();
+void Renderer::updateShaderFeatures(){
+	unsigned int features = ShaderProgram::NONE;
+	features |= _state.horizontalScroll ? ShaderProgram::HORIZONTAL : 0u;
+	features |= _state.reverseScroll ? ShaderProgram::REVERSE : 0u;
+	features |= _state.background.digits ? ShaderProgram::DIGITS : 0u;
+	features |= _state.background.hLines ? ShaderProgram::HLINES : 0u;
+	features |= _state.background.vLines ? ShaderProgram::VLINES : 0u;
+	features |= _state.keyboard.highlightKeys ? ShaderProgram::HIGHLIGHT_KEYS : 0u;
+	// Programs only compile a new permutation the first time a combination is used.
+	_scene->selectPermutations(features);
+	_score->program().select(features);
+}
 
+void Renderer::updateFrameUniforms(const glm::vec2 & invSize){
+	FrameUniforms & frame = _frameUniforms.data();
+	frame.inverseScreenSize = invSize;
+	frame.time = _timer;
+	frame.scrollTime = _timer * _state.scrollSpeed;
+	_frameUniforms.upload();
 }
 
 void Renderer::drawBackgroundImage(const glm::vec2 &) {
@@ -378,46 +699,39 @@ void Renderer::drawBackgroundImage(const glm::vec2 &) {
 	if(_state.background.tex == 0 || _state.background.imageAlpha < 1.0f/255.0f) {
 		return;
 	}
-	glEnable(GL_BLEND);
-	glUseProgram(_backgroundTexture.programId());
-	glUniform1f(glGetUniformLocation(_backgroundTexture.programId(), "textureAlpha"), _state.background.imageAlpha);
-	glUniform1i(glGetUniformLocation(_backgroundTexture.programId(), "behindKeyboard"), _state.background.imageBehindKeyboard);
-	glUniform1f(glGetUniformLocation(_backgroundTexture.programId(), "keyboardHeight"), _state.keyboard.size);
+	const ShaderProgram & program = _backgroundTexture.program();
+	program.use();
+	program.uniform(_backgroundAlphaUniform, _state.background.imageAlpha);
+	program.uniform(_backgroundBehindKeyboardUniform, _state.background.imageBehindKeyboard);
 	_backgroundTexture.draw(_state.background.tex, _timer);
-
-	glDisable(GL_BLEND);
 }
 
 void Renderer::drawBlur(const glm::vec2 &) {
-	glEnable(GL_BLEND);
-	_passthrough.draw(_blurFramebuffer1->textureId(), _timer);
-	glDisable(GL_BLEND);
+	_passthrough.draw(_blurFramebuffer->textureId(), _timer);
 }
 
-void Renderer::drawParticles(const glm::vec2 & invSize) {
-	_scene->drawParticles(_timer, invSize, _state.particles, false);
+void Renderer::drawParticles(const glm::vec2 &) {
+	_scene->drawParticles(_state.particles, false);
 }
 
-void Renderer::drawScore(const glm::vec2 & invSize) {
-	glEnable(GL_BLEND);
-	_score->draw(_timer * _state.scrollSpeed, invSize);
-	glDisable(GL_BLEND);
+void Renderer::drawScore(const glm::vec2 &) {
+	// Composite the cached score, see updateScoreCache.
+	const ShaderProgram & program = _scrollingCache.program();
+	program.use();
+	program.uniform(_scoreCacheOffsetUniform, _scoreCacheOffset);
+	_scrollingCache.draw(_scoreLayer.framebuffer()->textureId(), _timer);
 }
 
-void Renderer::drawKeyboard(const glm::vec2 & invSize) {
-	const ColorArray & majColors = _state.keyboard.customKeyColors ? _state.keyboard.majorColor : _state.baseColors;
-	const ColorArray & minColors = _state.keyboard.customKeyColors ? _state.keyboard.minorColor : _state.minorColors;
-	_scene->drawKeyboard(_timer, invSize, _state.background.keysColor, majColors, minColors, _state.keyboard.highlightKeys);
+void Renderer::drawKeyboard(const glm::vec2 &) {
+	_scene->drawKeyboard(_state.background.keysColor);
 }
 
-void Renderer::drawNotes(const glm::vec2 & invSize) {
-	glEnable(GL_BLEND);
-	_scene->drawNotes(_timer * _state.scrollSpeed, invSize, _state.baseColors, _state.minorColors, _state.reverseScroll, false);
-	glDisable(GL_BLEND);
+void Renderer::drawNotes(const glm::vec2 &) {
+	_scene->drawNotes(false);
 }
 
-void Renderer::drawFlashes(const glm::vec2 & invSize) {
-	_scene->drawFlashes(_timer, invSize, _state.flashColors, _state.flashSize);
+void Renderer::drawFlashes(const glm::vec2 &) {
+	_scene->drawFlashes(_state.flashSize);
 }
 
 void Renderer::drawPedals(const glm::vec2 & invSize){
@@ -425,8 +739,8 @@ void Renderer::drawPedals(const glm::vec2 & invSize){
 	_scene->drawPedals(_timer, invSize, _state.pedals, _state.keyboard.size + (_state.showWave ? 0.01f : 0.0f), _state.horizontalScroll);
 }
 
-void Renderer::drawWaves(const glm::vec2 & invSize){
-	_scene->drawWaves(_timer, invSize, _state.waves, _state.keyboard.size);
+void Renderer::drawWaves(const glm::vec2 &){
+	_scene->drawWaves(_timer, _state.waves);
 }
 
 SystemAction Renderer::drawGUI(const float currentTime) {
@@ -515,15 +829,10 @@ SystemAction Renderer::drawGUI(const float currentTime) {
 		ImGuiSameLine(COLUMN_SIZE);
 		ImGui::Checkbox("Smoothing", &_state.applyAA);
 
-		if(ImGui::Checkbox("Horizontal scroll", &_state.horizontalScroll)){
-			_score->setOrientation(_state.horizontalScroll);
-			_scene->setOrientation(_state.horizontalScroll);
-		}
+		ImGui::Checkbox("Horizontal scroll", &_state.horizontalScroll);
 		if(!_liveplay){
 			ImGuiSameLine(COLUMN_SIZE);
-			if(ImGui::Checkbox("Reverse scroll", &_state.reverseScroll)){
-				_score->setPlayDirection(_state.reverseScroll);
-			}
+			ImGui::Checkbox("Reverse scroll", &_state.reverseScroll);
 		}
 
 		if (ImGui::Checkbox("Use the same color for all effects", &_state.lockParticleColor)) {
@@ -568,8 +877,6 @@ SystemAction Renderer::drawGUI(const float currentTime) {
 			if (smw0) {
 				_state.scale = (std::max)(_state.scale, 0.01f);
 				_state.background.minorsWidth = glm::clamp(_state.background.minorsWidth, 0.1f, 1.0f);
-				_scene->setScaleAndMinorWidth(_state.scale, _state.background.minorsWidth);
-				_score->setScaleAndMinorWidth(_state.scale, _state.background.minorsWidth);
 			}
 
 			if(channelColorEdit("Notes", "Notes", _state.baseColors)){
@@ -586,7 +893,6 @@ SystemAction Renderer::drawGUI(const float currentTime) {
 			ImGuiPushItemWidth(100);
 			if(ImGui::SliderFloat("Fadeout", &_state.notesFadeOut, 0.0f, 1.0f)){
 				_state.notesFadeOut = glm::clamp(_state.notesFadeOut, 0.0f, 1.0f);
-				_scene->setKeyboardSizeAndFadeout(_state.keyboard.size, _state.notesFadeOut);
 			}
 			ImGui::PopItemWidth();
 
@@ -657,7 +963,14 @@ SystemAction Renderer::drawGUI(const float currentTime) {
 			ImGuiSameLine();
 			ImGui::TextDisabled("(press D to hide)");
 			ImGui::Text("%.1f FPS / %.1f ms", ImGui::GetIO().Framerate, ImGui::GetIO().DeltaTime * 1000.0f);
-			ImGui::Text("Render size: %dx%d, screen size: %dx%d", _renderFramebuffer->_width, _renderFramebuffer->_height, _camera.screenSize()[0], _camera.screenSize()[1]);
+			ImGui::Text("Render size: %dx%d, screen size: %dx%d", _finalFramebuffer->_width, _finalFramebuffer->_height, _camera.screenSize()[0], _camera.screenSize()[1]);
+			const GLState::Stats & glStats = GLState::lastFrame();
+			ImGui::Text("GL state calls: %u issued, %u skipped", glStats.issued, glStats.skipped);
+			const FrameGraph::Stats & graphStats = _frameGraph.lastFrame();
+			ImGui::Text("Passes: %u run, %u skipped", graphStats.passes, graphStats.skipped);
+			ImGui::Text("Intermediate targets: %u in %u framebuffers (%.1f MB)", graphStats.transients, graphStats.pooled, float(graphStats.pooledBytes) / (1024.0f * 1024.0f));
+			ImGui::Text("Idle frames: %u, blur settling: %d", _skippedFrames, _settleFrames);
+			showTimings();
 			if (ImGui::Button("Print MIDI content to console")) {
 				_scene->print();
 			}
@@ -809,6 +1122,11 @@ void Renderer::showParticleOptions(){
 	if (ImGui::SliderInt("Count", &_state.particles.count, 1, 512)) {
 		_state.particles.count = glm::clamp(_state.particles.count, 1, 512);
 	}
+	ImGuiSameLine(COLUMN_SIZE);
+	if (ImGui::SliderInt("Systems", &_state.particles.systems, 16, 4096)) {
+		_state.particles.systems = glm::clamp(_state.particles.systems, 16, 4096);
+		_scene->setParticlesPoolSize(_state.particles.systems);
+	}
 
 	ImGui::PopItemWidth();
 
@@ -880,8 +1198,6 @@ void Renderer::showKeyboardOptions(){
 	ImGuiPushItemWidth(100);
 	if(ImGuiSliderPercent("Height##Keys", &_state.keyboard.size, 0.0f, 1.0f)){
 		_state.keyboard.size = glm::clamp(_state.keyboard.size, 0.0f, 1.0f);
-		_scene->setKeyboardSizeAndFadeout(_state.keyboard.size, _state.notesFadeOut);
-		_score->setKeyboardSize(_state.keyboard.size);
 	}
 	ImGui::PopItemWidth();
 
@@ -953,15 +1269,35 @@ void Renderer::showWaveOptions(){
 
 }
 
+void Renderer::showTimings(){
+	if(!ImGui::TreeNode("Timings")){
+		return;
+	}
+	// Rolling graph of each section, GPU ones lag a few frames behind.
+	for(const auto & section : Profiler::sections()){
+		const std::string label = std::string(section.type == Profiler::Type::GPU ? "GPU " : "CPU ") + section.name;
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%.3f ms", section.last);
+		ImGui::PlotLines(label.c_str(), &section.history[0], int(Profiler::historySize), int(section.next), overlay, 0.0f, FLT_MAX, ImVec2(200.0f * _guiScale, 30.0f * _guiScale));
+	}
+	if(ImGui::Button("Save timings...")){
+		nfdchar_t *savePath = NULL;
+		nfdresult_t result = NFD_SaveDialog("csv", NULL, &savePath);
+		if(result == NFD_OKAY && savePath != nullptr){
+			Profiler::saveCSV(std::string(savePath));
+		}
+	}
+	ImGui::TreePop();
+}
+
 void Renderer::showBlurOptions(){
 	ImGui::Checkbox("Blur the notes", &_state.showBlurNotes);
 	ImGuiSameLine(COLUMN_SIZE);
 	ImGuiPushItemWidth(100);
 	if (ImGui::SliderFloat("Fading", &_state.attenuation, 0.0f, 1.0f)) {
 		_state.attenuation = glm::clamp(_state.attenuation, 0.0f, 1.0f);
-		glUseProgram(_blurringScreen.programId());
-		const GLuint id1 = glGetUniformLocation(_blurringScreen.programId(), "attenuationFactor");
-		glUniform1f(id1, _state.attenuation);
+		_blurUpsample.program().use();
+		_blurUpsample.program().uniform("attenuationFactor", _state.attenuation);
 		glUseProgram(0);
 	}
 	ImGui::PopItemWidth();
@@ -974,14 +1310,10 @@ void Renderer::showScoreOptions(){
 	const bool cbg1 = ImGui::ColorEdit3("Text##Background", &_state.background.textColor[0], ImGuiColorEditFlags_NoInputs);
 	ImGui::PopItemWidth();
 	ImGuiSameLine(COLUMN_SIZE);
-	const bool m1 = ImGui::Checkbox("Digits", &_state.background.digits);
-	const bool m2 = ImGui::Checkbox("Horizontal lines", &_state.background.hLines);
+	ImGui::Checkbox("Digits", &_state.background.digits);
+	ImGui::Checkbox("Horizontal lines", &_state.background.hLines);
 	ImGuiSameLine(COLUMN_SIZE);
-	const bool m3 = ImGui::Checkbox("Vertical lines", &_state.background.vLines);
-
-	if (m1 || m2 || m3) {
-		_score->setDisplay(_state.background.digits, _state.background.hLines, _state.background.vLines);
-	}
+	ImGui::Checkbox("Vertical lines", &_state.background.vLines);
 
 	if (cbg0 || cbg1) {
 		_score->setColors(_state.background.linesColor, _state.background.textColor, _state.background.keysColor);
@@ -1013,6 +1345,8 @@ void Renderer::showBackgroundOptions(){
 			_state.background.imagePath = std::string(outPath);
 			glDeleteTextures(1, &_state.background.tex);
 			_state.background.tex = loadTexture(_state.background.imagePath, 4, false);
+			// The new texture can reuse the name of the old one.
+			_constantLayers.invalidate();
 			if(_state.background.tex != 0){
 				_state.background.image = true;
 				// Ensure minimal visibility.
@@ -1413,47 +1747,32 @@ void Renderer::showSetEditor(){
 }
 
 void Renderer::applyBackgroundColor(){
-	// Clear all buffers with this color.
+	// Clear the blur history with this color, other intermediate targets are redrawn each frame.
 	glClearColor(_state.background.color[0], _state.background.color[1], _state.background.color[2], _useTransparency ? 0.0f : 1.0f);
-	_particlesFramebuffer->bind();
-	glClear(GL_COLOR_BUFFER_BIT);
-	_particlesFramebuffer->unbind();
-	_blurFramebuffer0->bind();
-	glClear(GL_COLOR_BUFFER_BIT);
-	_blurFramebuffer0->unbind();
-	_blurFramebuffer1->bind();
+	_blurFramebuffer->bind();
 	glClear(GL_COLOR_BUFFER_BIT);
-	_blurFramebuffer1->unbind();
+	_blurFramebuffer->unbind();
 	// Update parameter.
-	glUseProgram(_blurringScreen.programId());
-	GLuint id3 = glGetUniformLocation(_blurringScreen.programId(), "backgroundColor");
-	glUniform3fv(id3, 1, &_state.background.color[0]);
+	_blurUpsample.program().use();
+	_blurUpsample.program().uniform("backgroundColor", _state.background.color);
 	glUseProgram(0);
 }
 
 void Renderer::applyAllSettings() {
+	requestRedraw();
 	// Apply all modifications.
 
 	// One-shot parameters.
-	_scene->setScaleAndMinorWidth(_state.scale, _state.background.minorsWidth);
-	_score->setScaleAndMinorWidth(_state.scale, _state.background.minorsWidth);
 	_scene->setParticlesParameters(_state.particles.speed, _state.particles.expansion);
-	_score->setDisplay(_state.background.digits, _state.background.hLines, _state.background.vLines);
+	_scene->setParticlesPoolSize(_state.particles.systems);
 	_score->setColors(_state.background.linesColor, _state.background.textColor, _state.background.keysColor);
-	_scene->setKeyboardSizeAndFadeout(_state.keyboard.size, _state.notesFadeOut);
-	_score->setKeyboardSize(_state.keyboard.size);
-	_score->setPlayDirection(_state.reverseScroll);
-	
-	_score->setOrientation(_state.horizontalScroll);
-	_scene->setOrientation(_state.horizontalScroll);
 
 	updateMinMaxKeys();
 
 	// Reset buffers.
 	applyBackgroundColor();
-	glUseProgram(_blurringScreen.programId());
-	GLuint id2 = glGetUniformLocation(_blurringScreen.programId(), "attenuationFactor");
-	glUniform1f(id2, _state.attenuation);
+	_blurUpsample.program().use();
+	_blurUpsample.program().uniform("attenuationFactor", _state.attenuation);
 	glUseProgram(0);
 
 	// Resize the framebuffers.
@@ -1469,15 +1788,21 @@ void Renderer::clean() {
 	// Clean objects.
 	_scene->clean();
 	_score->clean();
-	_blurringScreen.clean();
+	_blurDownsample.clean();
+	_blurUpsample.clean();
 	_passthrough.clean();
 	_backgroundTexture.clean();
+	_scrollingCache.clean();
 	_fxaa.clean();
-	_particlesFramebuffer->clean();
-	_blurFramebuffer0->clean();
-	_blurFramebuffer1->clean();
+	_frameUniforms.clean();
+	_sceneUniforms.clean();
+	_paletteUniforms.clean();
+	_frameGraph.clean();
+	_blurFramebuffer->clean();
 	_finalFramebuffer->clean();
-	_renderFramebuffer->clean();
+	_constantLayers.clean();
+	_scoreLayer.clean();
+	Profiler::clean();
 }
 
 void Renderer::rescale(float scale){
@@ -1507,13 +1832,23 @@ void Renderer::resizeAndRescale(int width, int height, float scale) {
 }
 
 void Renderer::updateSizes(){
+	requestRedraw();
 	// Resize the framebuffers.
 	const auto &currentQuality = Quality::availables.at(_state.quality);
 	const glm::vec2 baseRes(_camera.renderSize());
-	_particlesFramebuffer->resize(currentQuality.particlesResolution * baseRes);
-	_blurFramebuffer0->resize(currentQuality.blurResolution * baseRes);
-	_blurFramebuffer1->resize(currentQuality.blurResolution * baseRes);
-	_renderFramebuffer->resize(currentQuality.finalResolution * baseRes);
+	_blurFramebuffer->resize(currentQuality.blurResolution * baseRes);
+	// Intermediate targets are allocated by the frame graph, only store their sizes.
+	_particlesSize = glm::ivec2(currentQuality.particlesResolution * baseRes);
+	// Adjust the blur chain depth.
+	const size_t levelsCount = size_t((std::max)(currentQuality.blurLevels, 1));
+	_blurLevelsSizes.resize(levelsCount);
+	glm::vec2 levelRes = currentQuality.blurResolution * baseRes;
+	for(auto & levelSize : _blurLevelsSizes){
+		levelRes = glm::max(glm::floor(0.5f * levelRes), glm::vec2(1.0f));
+		levelSize = glm::ivec2(levelRes);
+	}
+	// Release targets of the previous size right away.
+	_frameGraph.purge();
 	_finalFramebuffer->resize(currentQuality.finalResolution * baseRes);
 	_recorder.setSize(glm::ivec2(_finalFramebuffer->_width, _finalFramebuffer->_height));
 }
@@ -1540,6 +1875,7 @@ void Renderer::keyPressed(int key, int action) {
 }
 
 void Renderer::updateAudioPosition() {
+	TRACE_SCOPE("Audio seek");
 	if (_soundLoaded) {
 		if (_shouldPlay) {
 			// ma_sound_seek_to_pcm_frame(&_sound, static_cast<int>(timerStart * 44100));
@@ -1610,6 +1946,8 @@ void Renderer::setState(const State & state){
 		_state.background.tex = loadTexture(_state.background.imagePath, 4, false);
 		// Don't modify the rest of the potentially restored state.
 	}
+	_constantLayers.invalidate();
+	_scoreLayer.invalidate();
 
 	if(!_state.particles.imagePaths.empty()){
 		const auto & lPaths = _state.particles.imagePaths;
@@ -1668,6 +2006,10 @@ void Renderer::updateConfiguration(Configuration& config){
 	}
 }
 
+bool Renderer::isRecording() const {
+	return _recorder.isRecording();
+}
+
 bool Renderer::startDirectRecording(const Export& exporting, const glm::vec2 & size){
 	const bool success = _recorder.setParameters(exporting);
 	if(!success){
@@ -1676,6 +2018,10 @@ bool Renderer::startDirectRecording(const Export& exporting, const glm::vec2 & s
 	}
 	_recorder.setSize(size);
 	startRecording();
+	if(!_recorder.isRecording()){
+		std::cerr << "[EXPORT]: Unable to start direct export." << std::endl;
+		return false;
+	}
 	_exitAfterRecording = true;
 	return true;
 }
@@ -1683,6 +2029,18 @@ bool Renderer::startDirectRecording(const Export& exporting, const glm::vec2 & s
 void Renderer::startRecording(){
 	// We need to provide some information for the recorder to start.
 	_recorder.prepare(_state.prerollTime, float(_scene->duration()), _state.scrollSpeed);
+	// Settings and notes determine the frames, for an interrupted export to be resumed.
+	std::stringstream settings;
+	_state.write(settings);
+	std::stringstream midi;
+	std::shared_ptr<MIDISceneFile> fileScene = std::dynamic_pointer_cast<MIDISceneFile>(_scene);
+	if(fileScene){
+		std::ifstream midiFile = System::openInputFile(fileScene->midiFilePath(), true);
+		if(midiFile.is_open()){
+			midi << midiFile.rdbuf();
+		}
+	}
+	_recorder.setSources(settings.str(), midi.str());
 
 	// Start by clearing up all buffers.
 	// We need:
@@ -1708,19 +2066,51 @@ void Renderer::startRecording(){
 
 	// Reset buffers.
 	glClearColor(_state.background.color[0], _state.background.color[1], _state.background.color[2], _recorder.isTransparent() ? 0.0f : 1.0f);
-	_particlesFramebuffer->bind();
-	glClear(GL_COLOR_BUFFER_BIT);
-	_blurFramebuffer0->bind();
-	glClear(GL_COLOR_BUFFER_BIT);
-	_blurFramebuffer1->bind();
-	glClear(GL_COLOR_BUFFER_BIT);
-	_renderFramebuffer->bind();
+	_blurFramebuffer->bind();
 	glClear(GL_COLOR_BUFFER_BIT);
 	_finalFramebuffer->bind();
 	glClear(GL_COLOR_BUFFER_BIT);
 	_finalFramebuffer->unbind();
 
 	_recorder.start(_verbose);
+	if(_recorder.isRecording()){
+		warmUpEffects();
+	}
+}
+
+void Renderer::warmUpEffects(){
+	TRACE_SCOPE("Warm-up");
+	const size_t firstFrame = _recorder.firstFrame();
+	const float speed = _state.scrollSpeed;
+	// Particle systems started before this window have all ended. For the blur, the residual of the previous
+	// history has to fall close to the half float precision, not only below an 8-bit step, for frames to match.
+	// The score cache is rendered on a grid of scroll positions and needs no warm-up.
+	const size_t particlesFrames = size_t(std::ceil(_scene->particlesLifetime() / double(speed) * double(_recorder.framerate()))) + 1;
+	const size_t blurFrames = _state.showBlur ? 2 * size_t(blurSettleFrames()) : 0;
+	// Starting from the first frame gives exactly the state of a complete export.
+	const size_t startFrame = firstFrame - (std::min)(firstFrame, (std::max)(particlesFrames, blurFrames));
+	_scene->restartAt(speed * _recorder.frameTime((long long)(startFrame) - 1));
+
+	for(size_t frame = startFrame; frame < firstFrame; ++frame){
+		_timer = _recorder.frameTime(frame);
+		_scene->updatesActiveNotes(speed * _timer, speed);
+		if(frame + blurFrames < firstFrame){
+			continue;
+		}
+		// Only the blur history is kept between frames.
+		GLState::beginFrame();
+		Profiler::beginFrame();
+		updateUniformBuffers();
+		updateShaderFeatures();
+		_frameGraph.reset();
+		addBlurPasses(_frameGraph.import("Blur", _blurFramebuffer));
+		_frameGraph.execute();
+		Profiler::endFrame();
+		GLState::endFrame();
+	}
+	if(firstFrame > startFrame){
+		std::cout << "[EXPORT]: Warmed up effects over " << (firstFrame - startFrame) << " frames." << std::endl;
+	}
 }
 
 bool Renderer::channelColorEdit(const char * name, const char * displayName, ColorArray & colors){
@@ -1790,8 +2180,10 @@ void Renderer::updateMinMaxKeys(){
 	const int maxKeyMaj = (_state.maxKey/12) * 7 + noteShift[realMaxKey % 12];
 	const int noteCount = (maxKeyMaj - minKeyMaj + 1);
 
-	_scene->setMinMaxKeys(realMinKey, minKeyMaj, noteCount);
-	_score->setMinMaxKeys(realMinKey, minKeyMaj, noteCount);
+	SceneUniforms & scene = _sceneUniforms.data();
+	scene.minNote = realMinKey;
+	scene.minNoteMajor = minKeyMaj;
+	scene.notesCount = float(noteCount);
 }
 
 
@@ -7,10 +7,14 @@
 #include <array>
 
 #include "Framebuffer.h"
+#include "FrameGraph.h"
+#include "LayerCache.h"
 #include "camera/Camera.h"
 #include "scene/MIDIScene.h"
 #include "ScreenQuad.h"
 #include "Score.h"
+#include "UniformBuffer.h"
+#include "GLState.h"
 
 #include "../helpers/Recorder.h"
 
@@ -65,9 +69,18 @@ public:
 	/// Handle keyboard inputs
 	void keyPressed(int key, int action);
 
+	/// Notify of a user input or external change, the scene will be rendered again for a few frames.
+	void requestRedraw();
+
+	/// Is the scene static and fully settled, so that the application can wait for events.
+	bool isIdle() const;
+
 	/// Directly start recording.
 	bool startDirectRecording(const Export& exporting, const glm::vec2 & size);
 
+	/// Is an export in progress.
+	bool isRecording() const;
+
 	void setGUIScale(float scale);
 
 	void updateConfiguration(Configuration& config);
@@ -85,10 +98,29 @@ private:
 		std::string name = "None";
 		void (Renderer::*draw)(const glm::vec2 &) = nullptr;
 		bool * toggle = nullptr;
+		GLState::Setup state;
+		bool constant = false; ///< Only depends on the settings, not on the time or the notes.
 
 	};
 
-	void blurPrepass();
+	/// Declare the particles and blur passes, updating the blur history target.
+	void addBlurPasses(FrameGraph::Target blurTarget);
+
+	/// Uniforms of a blur pass updated at each level.
+	struct BlurUniforms {
+		ShaderProgram::Uniform offset;
+		ShaderProgram::Uniform lastLevel;
+	};
+
+	void drawBlurLevel(ScreenQuad & pass, const BlurUniforms & uniforms, FrameGraph::Target src, FrameGraph::Target dst, float offset, bool lastLevel);
+
+	void drawLayers(const std::shared_ptr<Framebuffer> & target, bool transparentBG);
+
+	/// Draw the enabled layers in [first, last) of the layers order.
+	void drawLayersRange(size_t first, size_t last, const glm::vec2 & invSize);
+
+	/// Render the score again if the scroll since the last update exceeds the cached margin or if settings changed.
+	void updateScoreCache(const glm::ivec2 & screenSize, const glm::vec2 & invSize);
 
 	void drawBackgroundImage(const glm::vec2 & invSize);
 
@@ -112,6 +144,18 @@ private:
 
 	void drawScene(bool transparentBG);
 
+	/// Number of frames for the blur feedback to fade out after the last change.
+	int blurSettleFrames() const;
+
+	/// Refresh the layout and palette blocks from the current state.
+	void updateUniformBuffers();
+
+	/// Select the shader permutations matching the scroll and display options.
+	void updateShaderFeatures();
+
+	/// Refresh the per-pass block for a target of the given inverse size.
+	void updateFrameUniforms(const glm::vec2 & invSize);
+
 	SystemAction showTopButtons(double currentTime);
 
 	void showParticleOptions();
@@ -124,6 +168,9 @@ private:
 
 	void showBlurOptions();
 
+	/// Graphs of the CPU and GPU timings, in the debug panel.
+	void showTimings();
+
 	void showScoreOptions();
 
 	void showBackgroundOptions();
@@ -150,6 +197,9 @@ private:
 
 	void startRecording();
 
+	/// Rebuild the effects depending on previous frames (particles, blur) from the frames preceding the first exported one.
+	void warmUpEffects();
+
 	void updateSizes();
 
 	bool channelColorEdit(const char * name, const char * displayName, ColorArray & colors);
@@ -173,22 +223,46 @@ private:
 	bool _showDebug = false;
 	bool _verbose = false;
 
+	// Damage tracking.
+	float _lastDrawnTimer = -1.0f; ///< Timer of the last rendered scene.
+	int _redrawFrames = 1; ///< Frames to render before considering the scene unchanged.
+	int _settleFrames = 0; ///< Frames to render for the blur to settle.
+	unsigned int _skippedFrames = 0; ///< Frames re-presented without rendering, since the last change.
+
 	Recorder _recorder;
 	
 	Camera _camera;
 	
-	std::shared_ptr<Framebuffer> _particlesFramebuffer;
-	std::shared_ptr<Framebuffer> _blurFramebuffer0;
-	std::shared_ptr<Framebuffer> _blurFramebuffer1;
-	std::shared_ptr<Framebuffer> _renderFramebuffer;
+	FrameGraph _frameGraph;
+	glm::ivec2 _particlesSize = glm::ivec2(1);
+	std::vector<glm::ivec2> _blurLevelsSizes; ///< Downsampled chain, each level half the size of the previous one.
+	std::shared_ptr<Framebuffer> _blurFramebuffer; ///< Blur history, kept between frames.
 	std::shared_ptr<Framebuffer> _finalFramebuffer;
 
+	// Layers caches.
+	LayerCache _constantLayers; ///< Background and constant layers at the bottom of the layers order.
+	LayerCache _scoreLayer; ///< Score over the screen and an extra margin along the scrolling direction.
+	int _scoreCacheOrigin = 0; ///< Scrolled pixels the score cache was rendered at, a multiple of the cache margin.
+	glm::vec2 _scoreCacheOffset = glm::vec2(0.0f); ///< Pixels offset of the screen in the score cache.
+
 	std::shared_ptr<MIDIScene> _scene;
-	ScreenQuad _blurringScreen;
+	ScreenQuad _blurDownsample;
+	ScreenQuad _blurUpsample;
 	ScreenQuad _passthrough;
 	ScreenQuad _backgroundTexture;
+	ScreenQuad _scrollingCache;
 	ScreenQuad _fxaa;
 	std::shared_ptr<Score> _score;
+	// Uniforms updated at each frame.
+	BlurUniforms _blurDownsampleUniforms;
+	BlurUniforms _blurUpsampleUniforms;
+	ShaderProgram::Uniform _backgroundAlphaUniform;
+	ShaderProgram::Uniform _backgroundBehindKeyboardUniform;
+	ShaderProgram::Uniform _scoreCacheOffsetUniform;
+
+	UniformBuffer<FrameUniforms> _frameUniforms;
+	UniformBuffer<SceneUniforms> _sceneUniforms;
+	UniformBuffer<PaletteUniforms> _paletteUniforms;
 	
 	ma_sound _sound;
 	ma_engine _engine;
@@ -204,6 +278,7 @@ private:
 	bool _showSetListEditor = false;
 	bool _exitAfterRecording = false;
 	bool _fullscreen = false;
+	bool _headless = false; ///< No window nor GUI, only direct exports.
 	bool _liveplay = false;
 	bool _useTransparency = false;
 	const bool _supportTransparency;
@@ -14,19 +14,23 @@ public:
 	/// Init function with measure time.
 	Score(double secondsPerMeasure);
 	
-	void setScaleAndMinorWidth(const float scale, const float width);
-	
-	void setDisplay(const bool digits, const bool horiz, const bool vert);
-	
 	void setColors(const glm::vec3 & linesColor, const glm::vec3 & textColor, const glm::vec3 & keysColor);
 
-	void setKeyboardSize(float keyboardHeight);
+	/// Range of screen UVs covered by the score, binds the program and sets the measure duration and colors.
+	void setUVRange(const glm::vec2 & uvRange);
 
-	void setMinMaxKeys(int minKey, int minKeyMajor, int notesCount);
+private:
 
-	void setPlayDirection(bool reverse);
+	float _secondsPerMeasure; ///< Duration of a measure.
+	glm::vec3 _linesColor = glm::vec3(1.0f);
+	glm::vec3 _textColor = glm::vec3(1.0f);
+	glm::vec3 _keysColor = glm::vec3(1.0f);
 
-	void setOrientation(bool horizontal);
+	ShaderProgram::Uniform _uvRangeUniform;
+	ShaderProgram::Uniform _secondsPerMeasureUniform;
+	ShaderProgram::Uniform _linesColorUniform;
+	ShaderProgram::Uniform _textColorUniform;
+	ShaderProgram::Uniform _keysColorUniform;
 
 };
 
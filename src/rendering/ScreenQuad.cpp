@@ -6,22 +6,25 @@
 #include "../helpers/ResourcesManager.h"
 
 #include "ScreenQuad.h"
+#include "GLState.h"
 
 ScreenQuad::ScreenQuad(){}
 
 ScreenQuad::~ScreenQuad(){}
 
-void ScreenQuad::init(GLuint textureId, const std::string & fragName, const std::string & vertName){
-	init(fragName, vertName);
+void ScreenQuad::init(GLuint textureId, const std::string & fragName, const std::string & vertName, unsigned int features){
+	init(fragName, vertName, features);
 	// Link the texture of the framebuffer for this program.
 	_textureId = textureId;
 	checkGLError();
 }
 
-void ScreenQuad::init(const std::string & fragName, const std::string & vertName) {
+void ScreenQuad::init(const std::string & fragName, const std::string & vertName, unsigned int features) {
 
 	// Load the shaders
-	_programId = createGLProgramFromStrings(ResourcesManager::getStringForShader(vertName), ResourcesManager::getStringForShader(fragName));
+	_program.init(vertName, fragName, features);
+	_timeUniform = _program.registerUniform("time");
+	_inverseScreenSizeUniform = _program.registerUniform("inverseScreenSize");
 
 	// Load geometry.
 	std::vector<float> quadVertices{ -1.0, -1.0,  0.0,
@@ -58,14 +61,10 @@ void ScreenQuad::init(const std::string & fragName, const std::string & vertName
 	glBindVertexArray(0);
 
 	// Link the texture of the framebuffer for this program.
-	glUseProgram(_programId);
-	GLuint texUniID = glGetUniformLocation(_programId, "screenTexture");
-	glUniform1i(texUniID, 0);
+	_program.use();
+	_program.uniform("screenTexture", 0);
 	glUseProgram(0);
 	checkGLError();
-
-	_screenId = glGetUniformLocation(_programId, "inverseScreenSize");
-	_timeId = glGetUniformLocation(_programId, "time");
 }
 
 void ScreenQuad::draw(float time) {
@@ -81,31 +80,26 @@ void ScreenQuad::draw(float time, glm::vec2 invScreenSize){
 void ScreenQuad::draw(GLuint texId, float time) {
 
 	// Select the program (and shaders).
-	glUseProgram(_programId);
+	_program.use();
 
-	glUniform1f(_timeId, time);
+	_program.uniform(_timeUniform, time);
 
 	// Active screen texture.
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texId);
+	GLState::bindTexture(0, GL_TEXTURE_2D, texId);
 
 	// Select the geometry.
-	glBindVertexArray(_vao);
+	GLState::bindVertexArray(_vao);
 	// Draw!
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
 	glDrawElements(GL_TRIANGLES, GLsizei(_count), GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
-	glUseProgram(0);
 }
 
 void ScreenQuad::draw(GLuint texid, float time, glm::vec2 invScreenSize) {
 
 	// Select the program (and shaders).
-	glUseProgram(_programId);
+	_program.use();
 
 	// Inverse screen size uniform.
-	glUniform2fv(_screenId, 1, &(invScreenSize[0]));
+	_program.uniform(_inverseScreenSizeUniform, invScreenSize);
 
 	draw(texid, time);
 }
@@ -114,6 +108,7 @@ void ScreenQuad::draw(GLuint texid, float time, glm::vec2 invScreenSize) {
 
 void ScreenQuad::clean(){
 	glDeleteVertexArrays(1, &_vao);
+	_program.clean();
 }
 
 
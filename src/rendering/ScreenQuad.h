@@ -4,6 +4,8 @@
 #include <gl3w/gl3w.h>
 #include <glm/glm.hpp>
 
+#include "ShaderProgram.h"
+
 
 class ScreenQuad {
 
@@ -14,9 +16,10 @@ public:
 	~ScreenQuad();
 
 	/// Init function
-	void init(GLuint textureId, const std::string & fragName, const std::string & vertName = "screenquad_vert");
+	/// \param features the shader features supported by the program (see ShaderProgram::Feature)
+	void init(GLuint textureId, const std::string & fragName, const std::string & vertName = "screenquad_vert", unsigned int features = ShaderProgram::NONE);
 
-	void init(const std::string & fragName, const std::string & vertName = "screenquad_vert");
+	void init(const std::string & fragName, const std::string & vertName = "screenquad_vert", unsigned int features = ShaderProgram::NONE);
 
 	/// Draw function
 	void draw(float time, glm::vec2 invScreenSize);
@@ -30,18 +33,18 @@ public:
 	/// Clean function
 	void clean();
 	
-	GLuint programId(){return _programId; }
+	ShaderProgram & program(){ return _program; }
 	
 protected:
-	GLuint _programId;
+	ShaderProgram _program;
 	
 private:
 	
 	GLuint _vao;
 	GLuint _ebo;
 	GLuint _textureId;
-	GLuint _timeId;
-	GLuint _screenId;
+	ShaderProgram::Uniform _timeUniform;
+	ShaderProgram::Uniform _inverseScreenSizeUniform;
 	
 	size_t _count;
 
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "../helpers/ProgramUtilities.h"
+#include "../helpers/ResourcesManager.h"
+
+#include "ShaderProgram.h"
+#include "UniformBuffer.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+
+ShaderProgram::ShaderProgram(){}
+
+void ShaderProgram::init(const std::string & vertName, const std::string & fragName, unsigned int supportedFeatures){
+	_vertName = vertName;
+	_fragName = fragName;
+	_supported = supportedFeatures;
+	_current = NONE;
+	compile(_current);
+	_id = _permutations[_current].id;
+	_locations = &_permutations[_current].locations;
+	_registeredLocations = &_permutations[_current].registered;
+}
+
+void ShaderProgram::select(unsigned int features){
+	features &= _supported;
+	if(features == _current){
+		return;
+	}
+	if(_permutations.count(features) == 0){
+		compile(features);
+	}
+	const Permutation & permutation = _permutations[features];
+	copyUniforms(_id, permutation.id);
+	_current = features;
+	_id = permutation.id;
+	_locations = &permutation.locations;
+	_registeredLocations = &permutation.registered;
+}
+
+void ShaderProgram::compile(unsigned int features){
+	// Each enabled feature is exposed as a define.
+	static const std::vector<std::pair<Feature, std::string>> defineNames = {
+		{ HORIZONTAL, "HORIZONTAL_MODE" },
+		{ REVERSE, "REVERSE_MODE" },
+		{ DIGITS, "USE_DIGITS" },
+		{ HLINES, "USE_HLINES" },
+		{ VLINES, "USE_VLINES" },
+		{ HIGHLIGHT_KEYS, "HIGHLIGHT_KEYS" }
+	};
+	std::vector<std::string> defines;
+	for(const auto & define : defineNames){
+		if(features & define.first){
+			defines.push_back(define.second);
+		}
+	}
+
+	Permutation & permutation = _permutations[features];
+	permutation.id = ProgramCache::program(ResourcesManager::getStringForShader(_vertName, defines), ResourcesManager::getStringForShader(_fragName, defines));
+	bindUniformBlocks(permutation.id);
+	cacheUniforms(permutation);
+}
+
+void ShaderProgram::bindUniformBlocks(GLuint id){
+	if(id == 0){
+		return;
+	}
+	// Attach each shared block used by the program to its fixed binding point.
+	GLint count = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	for(GLint bid = 0; bid < count; ++bid){
+		GLchar name[64];
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(id, GLuint(bid), 64, &length, name);
+		const auto block = UniformBlock::names.find(std::string(name, length));
+		if(block == UniformBlock::names.end()){
+			std::cerr << "[GL]: Unknown uniform block " << std::string(name, length) << "." << std::endl;
+			continue;
+		}
+		glUniformBlockBinding(id, GLuint(bid), block->second);
+	}
+	checkGLError();
+}
+
+void ShaderProgram::cacheUniforms(Permutation & permutation){
+	permutation.locations.clear();
+	const GLuint id = permutation.id;
+	if(id == 0){
+		return;
+	}
+	// Query all active uniforms once, instead of looking them up by name at each update.
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<GLchar> buffer((std::max)(maxLength, GLint(1)));
+
+	for(GLint uid = 0; uid < count; ++uid){
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		GLsizei length = 0;
+		glGetActiveUniform(id, GLuint(uid), GLsizei(buffer.size()), &length, &size, &type, &buffer[0]);
+		std::string name(&buffer[0], length);
+		const GLint location = glGetUniformLocation(id, name.c_str());
+		// Uniforms stored in blocks have no location.
+		if(location < 0){
+			continue;
+		}
+		// Arrays are reported as "name[0]", store them under their base name.
+		const std::string::size_type bracket = name.find('[');
+		if(bracket != std::string::npos){
+			name = name.substr(0, bracket);
+		}
+		permutation.locations[name] = location;
+	}
+	checkGLError();
+	resolveRegistered(permutation);
+}
+
+void ShaderProgram::resolveRegistered(Permutation & permutation){
+	permutation.registered.resize(_registered.size());
+	for(size_t rid = 0; rid < _registered.size(); ++rid){
+		const auto loc = permutation.locations.find(_registered[rid]);
+		permutation.registered[rid] = loc != permutation.locations.end() ? loc->second : -1;
+	}
+}
+
+void ShaderProgram::copyUniforms(GLuint from, GLuint to){
+	if(from == 0 || to == 0){
+		return;
+	}
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(from, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<GLchar> buffer((std::max)(maxLength, GLint(1)));
+
+	GLState::useProgram(to);
+	for(GLint uid = 0; uid < count; ++uid){
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		GLsizei length = 0;
+		glGetActiveUniform(from, GLuint(uid), GLsizei(buffer.size()), &length, &size, &type, &buffer[0]);
+		std::string name(&buffer[0], length);
+		const std::string::size_type bracket = name.find('[');
+		if(bracket != std::string::npos){
+			name = name.substr(0, bracket);
+		}
+		// Only scalars and vectors are used by the shaders.
+		int components = 0;
+		bool isFloat = true;
+		switch(type){
+			case GL_FLOAT: components = 1; break;
+			case GL_FLOAT_VEC2: components = 2; break;
+			case GL_FLOAT_VEC3: components = 3; break;
+			case GL_FLOAT_VEC4: components = 4; break;
+			case GL_INT: case GL_BOOL: components = 1; isFloat = false; break;
+			case GL_SAMPLER_2D: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_BUFFER: case GL_INT_SAMPLER_BUFFER: components = 1; isFloat = false; break;
+			case GL_INT_VEC2: case GL_BOOL_VEC2: components = 2; isFloat = false; break;
+			case GL_INT_VEC3: case GL_BOOL_VEC3: components = 3; isFloat = false; break;
+			case GL_INT_VEC4: case GL_BOOL_VEC4: components = 4; isFloat = false; break;
+			default: break;
+		}
+		for(GLint eid = 0; eid < size && components > 0; ++eid){
+			const std::string elemName = size > 1 ? (name + "[" + std::to_string(eid) + "]") : name;
+			const GLint src = glGetUniformLocation(from, elemName.c_str());
+			const GLint dst = glGetUniformLocation(to, elemName.c_str());
+			// Block members and uniforms absent from the new permutation.
+			if(src < 0 || dst < 0){
+				continue;
+			}
+			if(isFloat){
+				GLfloat values[4];
+				glGetUniformfv(from, src, values);
+				switch(components){
+					case 1: glUniform1fv(dst, 1, values); break;
+					case 2: glUniform2fv(dst, 1, values); break;
+					case 3: glUniform3fv(dst, 1, values); break;
+					default: glUniform4fv(dst, 1, values); break;
+				}
+			} else {
+				GLint values[4];
+				glGetUniformiv(from, src, values);
+				switch(components){
+					case 1: glUniform1iv(dst, 1, values); break;
+					case 2: glUniform2iv(dst, 1, values); break;
+					case 3: glUniform3iv(dst, 1, values); break;
+					default: glUniform4iv(dst, 1, values); break;
+				}
+			}
+		}
+	}
+	checkGLError();
+}
+
+void ShaderProgram::use() const {
+	GLState::useProgram(_id);
+}
+
+GLint ShaderProgram::location(const std::string & name) const {
+	if(_locations == nullptr){
+		return -1;
+	}
+	const auto loc = _locations->find(name);
+	return loc != _locations->end() ? loc->second : -1;
+}
+
+ShaderProgram::Uniform ShaderProgram::registerUniform(const std::string & name){
+	const auto existing = std::find(_registered.begin(), _registered.end(), name);
+	if(existing != _registered.end()){
+		return Uniform(size_t(existing - _registered.begin()));
+	}
+	_registered.push_back(name);
+	for(auto & permutation : _permutations){
+		resolveRegistered(permutation.second);
+	}
+	return Uniform(_registered.size() - 1);
+}
+
+GLint ShaderProgram::location(Uniform handle) const {
+	if(_registeredLocations == nullptr || handle.id >= _registeredLocations->size()){
+		return -1;
+	}
+	return (*_registeredLocations)[handle.id];
+}
+
+void ShaderProgram::uniform(const std::string & name, float value) const {
+	glUniform1f(location(name), value);
+}
+
+void ShaderProgram::uniform(const std::string & name, int value) const {
+	glUniform1i(location(name), value);
+}
+
+void ShaderProgram::uniform(const std::string & name, bool value) const {
+	glUniform1i(location(name), value ? 1 : 0);
+}
+
+void ShaderProgram::uniform(const std::string & name, const glm::vec2 & value) const {
+	glUniform2fv(location(name), 1, &value[0]);
+}
+
+void ShaderProgram::uniform(const std::string & name, const glm::vec3 & value) const {
+	glUniform3fv(location(name), 1, &value[0]);
+}
+
+void ShaderProgram::uniform(const std::string & name, const glm::vec4 & value) const {
+	glUniform4fv(location(name), 1, &value[0]);
+}
+
+void ShaderProgram::uniform(Uniform handle, float value) const {
+	glUniform1f(location(handle), value);
+}
+
+void ShaderProgram::uniform(Uniform handle, int value) const {
+	glUniform1i(location(handle), value);
+}
+
+void ShaderProgram::uniform(Uniform handle, bool value) const {
+	glUniform1i(location(handle), value ? 1 : 0);
+}
+
+void ShaderProgram::uniform(Uniform handle, const glm::vec2 & value) const {
+	glUniform2fv(location(handle), 1, &value[0]);
+}
+
+void ShaderProgram::uniform(Uniform handle, const glm::vec3 & value) const {
+	glUniform3fv(location(handle), 1, &value[0]);
+}
+
+void ShaderProgram::uniform(Uniform handle, const glm::vec4 & value) const {
+	glUniform4fv(location(handle), 1, &value[0]);
+}
+
+void ShaderProgram::uniforms(const std::string & name, size_t count, const int * values) const {
+	glUniform1iv(location(name), GLsizei(count), values);
+}
+
+void ShaderProgram::uniforms(const std::string & name, size_t count, const glm::vec3 * values) const {
+	glUniform3fv(location(name), GLsizei(count), &(values[0][0]));
+}
+
+void ShaderProgram::clean(){
+	for(const auto & permutation : _permutations){
+		glDeleteProgram(permutation.second.id);
+	}
+	_permutations.clear();
+	_id = 0;
+	_locations = nullptr;
+	_registeredLocations = nullptr;
+	_current = NONE;
+}
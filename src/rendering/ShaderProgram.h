@@ -0,0 +1,124 @@
+#ifndef ShaderProgram_h
+#define ShaderProgram_h
+#include <gl3w/gl3w.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+class ShaderProgram {
+
+public:
+
+	/// Compile-time features, each enabled one adds a define to the shaders of a permutation.
+	enum Feature : unsigned int {
+		NONE = 0,
+		HORIZONTAL = 1 << 0, ///< HORIZONTAL_MODE
+		REVERSE = 1 << 1, ///< REVERSE_MODE
+		DIGITS = 1 << 2, ///< USE_DIGITS
+		HLINES = 1 << 3, ///< USE_HLINES
+		VLINES = 1 << 4, ///< USE_VLINES
+		HIGHLIGHT_KEYS = 1 << 5 ///< HIGHLIGHT_KEYS
+	};
+
+	/// Uniform registered at setup, to be updated without a name lookup.
+	struct Uniform {
+		explicit Uniform(size_t index = size_t(-1)) : id(index) {}
+		size_t id;
+	};
+
+	ShaderProgram();
+
+	/// Compile and link the program from the embedded shaders with the given names, bind its shared uniform blocks and cache its uniform locations.
+	/// \param supportedFeatures the features the shaders react to, others are ignored when selecting a permutation
+	void init(const std::string & vertName, const std::string & fragName, unsigned int supportedFeatures = NONE);
+
+	/// Switch to the permutation for the given features, compiling it on first use.
+	/// Uniform values are carried over from the previously selected permutation.
+	void select(unsigned int features);
+
+	/// Bind the program.
+	void use() const;
+
+	/// Cached location of a uniform, or -1 if the program doesn't use it.
+	GLint location(const std::string & name) const;
+
+	/// Register a uniform updated at each frame, its location is resolved for each permutation.
+	Uniform registerUniform(const std::string & name);
+
+	/// Location of a registered uniform in the selected permutation, or -1 if it doesn't use it.
+	GLint location(Uniform handle) const;
+
+	/// Uniform setters by name, for setup code. The program has to be bound beforehand.
+	void uniform(const std::string & name, float value) const;
+
+	void uniform(const std::string & name, int value) const;
+
+	void uniform(const std::string & name, bool value) const;
+
+	void uniform(const std::string & name, const glm::vec2 & value) const;
+
+	void uniform(const std::string & name, const glm::vec3 & value) const;
+
+	void uniform(const std::string & name, const glm::vec4 & value) const;
+
+	/// Registered uniform setters, for per-frame updates. The program has to be bound beforehand.
+	void uniform(Uniform handle, float value) const;
+
+	void uniform(Uniform handle, int value) const;
+
+	void uniform(Uniform handle, bool value) const;
+
+	void uniform(Uniform handle, const glm::vec2 & value) const;
+
+	void uniform(Uniform handle, const glm::vec3 & value) const;
+
+	void uniform(Uniform handle, const glm::vec4 & value) const;
+
+	/// Array uniform setters, the program has to be bound beforehand.
+	void uniforms(const std::string & name, size_t count, const int * values) const;
+
+	void uniforms(const std::string & name, size_t count, const glm::vec3 * values) const;
+
+	/// Clean function
+	void clean();
+
+	GLuint id() const { return _id; }
+
+	/// Features of the selected permutation.
+	unsigned int features() const { return _current; }
+
+private:
+
+	struct Permutation {
+		GLuint id = 0;
+		std::unordered_map<std::string, GLint> locations;
+		std::vector<GLint> registered; ///< Locations of the registered uniforms.
+	};
+
+	void compile(unsigned int features);
+
+	void bindUniformBlocks(GLuint id);
+
+	void cacheUniforms(Permutation & permutation);
+
+	/// Resolve the locations of all registered uniforms in a permutation.
+	void resolveRegistered(Permutation & permutation);
+
+	void copyUniforms(GLuint from, GLuint to);
+
+	std::string _vertName;
+	std::string _fragName;
+	unsigned int _supported = NONE;
+	unsigned int _current = NONE;
+	std::unordered_map<unsigned int, Permutation> _permutations;
+	std::vector<std::string> _registered; ///< Names of the registered uniforms.
+
+	GLuint _id = 0;
+	const std::unordered_map<std::string, GLint> * _locations = nullptr;
+	const std::vector<GLint> * _registeredLocations = nullptr;
+
+};
+
+#endif
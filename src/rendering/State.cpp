@@ -21,21 +21,21 @@ const std::unordered_map<std::string, Quality::Level> Quality::names = {
 };
 
 const std::unordered_map<Quality::Level, Quality> Quality::availables = {
-	{ Quality::LOW_RES, { Quality::LOW_RES, 0.5f, 0.5f, 0.5f}},
-	{ Quality::LOW, { Quality::LOW, 0.5f, 0.5f, 1.0f}},
-	{ Quality::MEDIUM, { Quality::MEDIUM, 0.5f, 1.0f, 1.0f}},
-	{ Quality::HIGH, { Quality::HIGH, 1.0f, 1.0f, 1.0f}},
-	{ Quality::HIGH_RES, { Quality::HIGH_RES, 1.0f, 2.0f, 2.0f}}
+	{ Quality::LOW_RES, { Quality::LOW_RES, 0.5f, 0.5f, 0.5f, 1}},
+	{ Quality::LOW, { Quality::LOW, 0.5f, 0.5f, 1.0f, 1}},
+	{ Quality::MEDIUM, { Quality::MEDIUM, 0.5f, 1.0f, 1.0f, 2}},
+	{ Quality::HIGH, { Quality::HIGH, 1.0f, 1.0f, 1.0f, 2}},
+	{ Quality::HIGH_RES, { Quality::HIGH_RES, 1.0f, 2.0f, 2.0f, 3}}
 };
 
-Quality::Quality(const Quality::Level & alevel, const float partRes, const float blurRes, const float finRes){
+Quality::Quality(const Quality::Level & alevel, const float partRes, const float blurRes, const float finRes, const int blurDepth){
 	for(const auto & kv : names){
 		if(kv.second == alevel){
 			name = kv.first;
 			break;
 		}
 	}
-	particlesResolution = partRes; blurResolution = blurRes; finalResolution = finRes;
+	particlesResolution = partRes; blurResolution = blurRes; finalResolution = finRes; blurLevels = blurDepth;
 }
 
 State::OptionInfos::OptionInfos(){
@@ -83,6 +83,7 @@ State::OptionInfos::OptionInfos(const std::string & adesc, State::OptionInfos::T
 void State::defineOptions(){
 	// Integers.
 	_sharedInfos["particles-count"] = {"Particles count", OptionInfos::Type::INTEGER, {1.0f, 512.0f}};
+	_sharedInfos["particles-systems"] = {"Maximum number of simultaneous particle systems, the oldest ones are recycled when exceeded", OptionInfos::Type::INTEGER, {16.0f, 4096.0f}};
 
 	// Booleans.
 	_sharedInfos["show-particles"] = {"Should particles be shown", OptionInfos::Type::BOOLEAN};
@@ -228,6 +229,7 @@ void State::updateOptions(){
 	}
 
 	_intInfos["particles-count"] = &particles.count;
+	_intInfos["particles-systems"] = &particles.systems;
 	_boolInfos["show-particles"] = &showParticles;
 	_boolInfos["show-flashes"] = &showFlashes;
 	_boolInfos["show-blur"] = &showBlur;
@@ -315,6 +317,13 @@ void State::save(const std::string & path){
 		std::cerr << "[CONFIG]: Unable to save state to file at path " << outputPath << std::endl;
 		return;
 	}
+	write(configFile);
+	configFile.close();
+
+	_filePath = outputPath;
+}
+
+void State::write(std::ostream & configFile){
 	// Make sure the parameter pointers are up to date.
 	updateOptions();
 
@@ -373,10 +382,6 @@ void State::save(const std::string & path){
 	configFile << std::endl << "# " << _sharedInfos["sets-separator-control-points"].description << " (";
 	configFile << _sharedInfos["sets-separator-control-points"].values << ")" << std::endl;
 	configFile << "sets-separator-control-points: " << setOptions.toKeysString(" ") << std::endl;
-
-	configFile.close();
-
-	_filePath = outputPath;
 }
 
 bool State::load(const std::string & path){
@@ -582,6 +587,7 @@ void State::reset(){
 	particles.expansion = 1.0f;
 	particles.scale = 1.0f;
 	particles.count = 256;
+	particles.systems = 256;
 	particles.imagePaths = "";
 	const GLuint blankID = ResourcesManager::getTextureFor("blankarray");
 	particles.tex = blankID;
@@ -9,6 +9,7 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <string>
+#include <ostream>
 #include <unordered_map>
 #include <array>
 
@@ -36,10 +37,11 @@ struct Quality {
 	float particlesResolution = 0.5f;
 	float blurResolution = 1.0f;
 	float finalResolution = 1.0f;
+	int blurLevels = 2; ///< Depth of the downsampled blur chain.
 	
 	Quality() = default;
 	
-	Quality(const Quality::Level & alevel, const float partRes, const float blurRes, const float finRes);
+	Quality(const Quality::Level & alevel, const float partRes, const float blurRes, const float finRes, const int blurDepth);
 };
 	
 
@@ -72,6 +74,7 @@ public:
 		float expansion; ///< Expansion factor.
 		float scale; ///< Particles scale.
 		int count; ///< Number of particles.
+		int systems; ///< Maximum number of simultaneous particle systems.
 	};
 
 	struct KeyboardState {
@@ -148,6 +151,9 @@ public:
 	void load(const Arguments & configArgs);
 
 	void save(const std::string & path);
+
+	/// Write all options in the configuration file format.
+	void write(std::ostream & configFile);
 	
 	void reset();
 
@@ -0,0 +1,8 @@
+#include "UniformBuffer.h"
+
+// Shared uniform blocks names.
+const std::unordered_map<std::string, UniformBlock::Binding> UniformBlock::names = {
+	{ "FrameData", UniformBlock::FRAME },
+	{ "SceneData", UniformBlock::SCENE },
+	{ "PaletteData", UniformBlock::PALETTE }
+};
@@ -0,0 +1,99 @@
+#ifndef UniformBuffer_h
+#define UniformBuffer_h
+#include <gl3w/gl3w.h>
+#include <glm/glm.hpp>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "SetOptions.h"
+
+/// Uniform blocks shared by all programs, bound once to fixed binding points.
+struct UniformBlock {
+	enum Binding : GLuint {
+		FRAME = 0,
+		SCENE,
+		PALETTE,
+		COUNT
+	};
+
+	/// Block names as declared in the shaders.
+	static const std::unordered_map<std::string, Binding> names;
+};
+
+/// Per-pass values (std140 layout of the FrameData block).
+struct FrameUniforms {
+	glm::vec2 inverseScreenSize = glm::vec2(1.0f);
+	float time = 0.0f;
+	float scrollTime = 0.0f;
+};
+
+/// Keyboard layout and scrolling setup (std140 layout of the SceneData block).
+struct SceneUniforms {
+	float keyboardHeight = 0.25f;
+	float notesCount = 75.0f;
+	int minNote = 0;
+	int minNoteMajor = 0;
+	float mainSpeed = 1.0f;
+	float minorsWidth = 1.0f;
+	float fadeOut = 0.0f;
+	float padding[1] = {0.0f};
+};
+
+/// Colors of each set, vec3 arrays have a 16 bytes stride in std140 (layout of the PaletteData block).
+struct PaletteUniforms {
+	glm::vec4 notesMajor[SETS_COUNT];
+	glm::vec4 notesMinor[SETS_COUNT];
+	glm::vec4 flashes[SETS_COUNT];
+	glm::vec4 particles[SETS_COUNT];
+	glm::vec4 keysMajor[SETS_COUNT];
+	glm::vec4 keysMinor[SETS_COUNT];
+};
+
+/// GPU copy of a uniform block, only re-uploaded when its content changes.
+template<typename T>
+class UniformBuffer {
+
+public:
+
+	/// Create the buffer and attach it to its binding point.
+	void init(UniformBlock::Binding binding){
+		_uploaded = T();
+		glGenBuffers(1, &_id);
+		glBindBuffer(GL_UNIFORM_BUFFER, _id);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, _id);
+		_dirty = true;
+	}
+
+	/// CPU side values, call upload() to send them to the GPU.
+	T & data(){ return _data; }
+
+	/// Upload the values if they differ from the last uploaded ones.
+	void upload(){
+		if(!_dirty && std::memcmp(&_data, &_uploaded, sizeof(T)) == 0){
+			return;
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, _id);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &_data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		_uploaded = _data;
+		_dirty = false;
+	}
+
+	/// Clean function
+	void clean(){
+		glDeleteBuffers(1, &_id);
+		_id = 0;
+	}
+
+private:
+
+	T _data;
+	T _uploaded;
+	GLuint _id = 0;
+	bool _dirty = true;
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "../../helpers/ResourcesManager.h"
 
 #include "MIDIScene.h"
+#include "../GLState.h"
 
 #include <imgui/imgui.h>
 
@@ -40,16 +41,21 @@ void MIDIScene::renderSetup(){
 	glBindBuffer(GL_ARRAY_BUFFER, _dataBuffer);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 1000, nullptr, GL_STATIC_DRAW);
 
-	// Enabled notes buffer (empty for now).
+	// Enabled notes buffer (empty for now), shared by the flashes and the keyboard.
 	_flagsBufferId = 0;
 	glGenBuffers(1, &_flagsBufferId);
 	glBindBuffer(GL_ARRAY_BUFFER, _flagsBufferId);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(int) * 128, NULL, GL_DYNAMIC_DRAW);
+	glGenTextures(1, &_texFlags);
+	glBindTexture(GL_TEXTURE_BUFFER, _texFlags);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, _flagsBufferId);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
 
 	// Programs.
 
 	// Notes shaders.
-	_programId = createGLProgramFromStrings(ResourcesManager::getStringForShader("notes_vert"), ResourcesManager::getStringForShader("notes_frag"));
+	_programNotes.init("notes_vert", "notes_frag", ShaderProgram::HORIZONTAL | ShaderProgram::REVERSE);
+	_notesColorScale = _programNotes.registerUniform("colorScale");
 
 	// Generate a vertex array (useful when we add other attributes to the geometry).
 	_vao = 0;
@@ -82,7 +88,8 @@ void MIDIScene::renderSetup(){
 	checkGLError();
 
 	// Flashes shaders.
-	_programFlashesId = createGLProgramFromStrings(ResourcesManager::getStringForShader("flashes_vert"), ResourcesManager::getStringForShader("flashes_frag"));
+	_programFlashes.init("flashes_vert", "flashes_frag", ShaderProgram::HORIZONTAL);
+	_flashesUserScale = _programFlashes.registerUniform("userScale");
 
 	glGenVertexArrays (1, &_vaoFlashes);
 	glBindVertexArray(_vaoFlashes);
@@ -101,16 +108,19 @@ void MIDIScene::renderSetup(){
 
 	// Flash texture loading.
 	_texFlash = ResourcesManager::getTextureFor("flash");
-	glUseProgram(_programFlashesId);
+	_programFlashes.use();
 	glActiveTexture(GL_TEXTURE0);
-	GLuint texUniID = glGetUniformLocation(_programFlashesId, "textureFlash");
-	glUniform1i(texUniID, 0);
+	_programFlashes.uniform("textureFlash", 0);
 	glUseProgram(0);
 
 
 	// Particles program.
 
-	_programParticulesId = createGLProgramFromStrings(ResourcesManager::getStringForShader("particles_vert"), ResourcesManager::getStringForShader("particles_frag"));
+	_programParticles.init("particles_vert", "particles_frag", ShaderProgram::HORIZONTAL);
+	_particlesColorScale = _programParticles.registerUniform("colorScale");
+	_particlesScale = _programParticles.registerUniform("scale");
+	_particlesTexCount = _programParticles.registerUniform("texCount");
+	_particlesPerSystem = _programParticles.registerUniform("particlesPerSystem");
 
 	glGenVertexArrays (1, &_vaoParticles);
 	glBindVertexArray(_vaoParticles);
@@ -123,24 +133,34 @@ void MIDIScene::renderSetup(){
 
 	// Particles trajectories texture loading.
 	_texParticles = ResourcesManager::getTextureFor("particles");
-	glUseProgram(_programParticulesId);
+	_programParticles.use();
 	glActiveTexture(GL_TEXTURE0);
-	GLuint texUniID1 = glGetUniformLocation(_programParticulesId, "textureParticles");
-	glUniform1i(texUniID1, 0);
-
-	glUseProgram(_programParticulesId);
+	_programParticles.uniform("textureParticles", 0);
 	glActiveTexture(GL_TEXTURE1);
-	GLuint texUniID2 = glGetUniformLocation(_programParticulesId, "lookParticles");
-	glUniform1i(texUniID2, 1);
+	_programParticles.uniform("lookParticles", 1);
+	_programParticles.uniform("systems", 2);
+
+	// Live particles systems, refreshed before drawing.
+	glGenBuffers(1, &_particlesBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, _particlesBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+	glGenTextures(1, &_texParticlesData);
+	glBindTexture(GL_TEXTURE_BUFFER, _texParticlesData);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _particlesBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
 	// Pass texture size to shader.
 	const glm::vec2 tsize = ResourcesManager::getTextureSizeFor("particles");
-	GLuint texSizeID = glGetUniformLocation(_programParticulesId, "inverseTextureSize");
-	glUniform2f(texSizeID, 1.0f/float(tsize[0]), 1.0f/float(tsize[1]));
+	_programParticles.uniform("inverseTextureSize", 1.0f / tsize);
 	glUseProgram(0);
 
 	// Keyboard setup.
-	_programKeysId = createGLProgramFromStrings(ResourcesManager::getStringForShader("keys_vert"), ResourcesManager::getStringForShader("keys_frag"));
+	_programKeys.init("keys_vert", "keys_frag", ShaderProgram::HORIZONTAL | ShaderProgram::HIGHLIGHT_KEYS);
+	_keysColor = _programKeys.registerUniform("keysColor");
+	_programKeys.use();
+	_programKeys.uniform("actives", 0);
+	glUseProgram(0);
 	glGenVertexArrays(1, &_vaoKeyboard);
 	glBindVertexArray(_vaoKeyboard);
 	// The first attribute will be the vertices positions.
@@ -153,7 +173,13 @@ void MIDIScene::renderSetup(){
 	glBindVertexArray(0);
 
 	// Pedals setup.
-	_programPedalsId = createGLProgramFromStrings(ResourcesManager::getStringForShader("pedal_vert"), ResourcesManager::getStringForShader("pedal_frag"));
+	_programPedals.init("pedal_vert", "pedal_frag");
+	_pedalsColor = _programPedals.registerUniform("pedalColor");
+	_pedalsScale = _programPedals.registerUniform("scale");
+	_pedalsShift = _programPedals.registerUniform("shift");
+	_pedalsOpacity = _programPedals.registerUniform("pedalOpacity");
+	_pedalsFlags = _programPedals.registerUniform("pedalFlags");
+	_pedalsMerge = _programPedals.registerUniform("mergePedals");
 	// Create an array buffer to host the geometry data.
 	GLuint vboPdl = 0;
 	glGenBuffers(1, &vboPdl);
@@ -173,7 +199,13 @@ void MIDIScene::renderSetup(){
 	_countPedals = pedalsIndices.size();
 
 	// Wave setup.
-	_programWaveId = createGLProgramFromStrings(ResourcesManager::getStringForShader("wave_vert"), ResourcesManager::getStringForShader("wave_frag"));
+	_programWave.init("wave_vert", "wave_frag", ShaderProgram::HORIZONTAL);
+	_waveColor = _programWave.registerUniform("waveColor");
+	_waveOpacity = _programWave.registerUniform("waveOpacity");
+	_waveSpread = _programWave.registerUniform("spread");
+	_waveAmplitude = _programWave.registerUniform("amplitude");
+	_waveFrequency = _programWave.registerUniform("freq");
+	_wavePhase = _programWave.registerUniform("phase");
 	// Create an array buffer to host the geometry data.
 	const int numSegments = 512;
 	std::vector<glm::vec2> waveVerts((numSegments+1)*2);
@@ -212,201 +244,230 @@ void MIDIScene::renderSetup(){
 
 	// Prepare actives notes array.
 	_actives.fill(-1);
+	_activesUploaded = _actives;
+	glBindBuffer(GL_ARRAY_BUFFER, _flagsBufferId);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, _actives.size() * sizeof(int), &(_actives[0]));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	// Particle systems pool.
-	_particles = std::vector<Particles>(256);
-}
-
-void MIDIScene::setScaleAndMinorWidth(const float scale, const float minorWidth){
-	glUseProgram(_programId);
-	GLuint speedID = glGetUniformLocation(_programId, "mainSpeed");
-	glUniform1f(speedID, scale);
-	GLuint widthId = glGetUniformLocation(_programId, "minorsWidth");
-	glUniform1f(widthId, minorWidth);
-	glUseProgram(_programKeysId);
-	GLuint widthId1 = glGetUniformLocation(_programKeysId, "minorsWidth");
-	glUniform1f(widthId1, minorWidth);
-	glUseProgram(0);
+	setParticlesPoolSize(256);
 }
 
 void MIDIScene::setParticlesParameters(const float speed, const float expansion){
-	glUseProgram(_programParticulesId);
-	GLuint id0 = glGetUniformLocation(_programParticulesId, "speedScaling");
-	glUniform1f(id0, speed);
-	GLuint id1 = glGetUniformLocation(_programParticulesId, "expansionFactor");
-	glUniform1f(id1, expansion);
-	glUseProgram(0);
-}
-
-void MIDIScene::setKeyboardSizeAndFadeout(float keyboardHeight, float fadeOut){
-	const float fadeOutFinal = keyboardHeight + (1.0f - keyboardHeight) * (1.0f - fadeOut);
-
-	glUseProgram(_programId);
-	glUniform1f(glGetUniformLocation(_programId, "keyboardHeight"), keyboardHeight);
-	glUniform1f(glGetUniformLocation(_programId, "fadeOut"), fadeOutFinal);
-	glUseProgram(_programParticulesId);
-	glUniform1f(glGetUniformLocation(_programParticulesId, "keyboardHeight"), keyboardHeight);
-	glUseProgram(_programKeysId);
-	glUniform1f(glGetUniformLocation(_programKeysId, "keyboardHeight"), keyboardHeight);
-	glUseProgram(_programFlashesId);
-	glUniform1f(glGetUniformLocation(_programFlashesId, "keyboardHeight"), keyboardHeight);
+	_programParticles.use();
+	_programParticles.uniform("speedScaling", speed);
+	_programParticles.uniform("expansionFactor", expansion);
 	glUseProgram(0);
 }
 
 void MIDIScene::resetParticles() {
-	for (auto & particle : _particles) {
-		particle.note = -1;
-		particle.set = -1;
+	_particlesFree.resize(_particles.size());
+	for(size_t pid = 0; pid < _particles.size(); ++pid){
+		Particles & particle = _particles[pid];
+		particle.note = particle.set = -1;
 		particle.duration = particle.start = particle.elapsed = 0.0f;
+		particle.prev = particle.next = -1;
+		// Lower slots are used first.
+		_particlesFree[pid] = int(_particles.size() - 1 - pid);
 	}
+	_particlesFirst = _particlesLast = -1;
 }
 
-void MIDIScene::drawParticles(float time, const glm::vec2 & invScreenSize, const State::ParticlesState & state, bool prepass){
+void MIDIScene::restartAt(double){
+	resetParticles();
+}
 
-	glEnable(GL_BLEND);
-	glUseProgram(_programParticulesId);
-	
-	// Common uniforms values.
-	GLuint screenId = glGetUniformLocation(_programParticulesId, "inverseScreenSize");
-	GLuint timeId = glGetUniformLocation(_programParticulesId, "time");
-	GLuint durationId = glGetUniformLocation(_programParticulesId, "duration");
-	glUniform2fv(screenId,1, &(invScreenSize[0]));
-	glUniform1f(timeId,0.0);
-
-	// Variable uniforms.
-	GLuint globalShiftId = glGetUniformLocation(_programParticulesId, "globalId");
-	GLuint scaleId = glGetUniformLocation(_programParticulesId, "scale");
-	GLuint colorId = glGetUniformLocation(_programParticulesId, "baseColor");
-	GLuint channelId = glGetUniformLocation(_programParticulesId, "channel");
-	
-	// Prepass : bigger, darker particles.
-	GLuint colorScaleId = glGetUniformLocation(_programParticulesId, "colorScale");
-	glUniform1f(colorScaleId, prepass ? 0.6f : 1.6f);
-	glUniform1f(scaleId, state.scale * (prepass ? 2.0f : 1.0f));
+double MIDIScene::particlesLifetime() const {
+	// Systems can last as long as the notes.
+	return duration();
+}
 
-	glUniform3fv(colorId, GLsizei(state.colors.size()), &state.colors[0][0]);
-	
-	// Particles trajectories texture.
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, _texParticles);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, state.tex);
-	GLuint texCountId = glGetUniformLocation(_programParticulesId, "texCount");
-	glUniform1i(texCountId, state.texCount);
+void MIDIScene::setParticlesPoolSize(int size){
+	const size_t count = size_t((std::max)(size, 1));
+	if(count == _particles.size()){
+		return;
+	}
+	_particles = std::vector<Particles>(count);
+	resetParticles();
+}
 
-	// Select the geometry.
-	glBindVertexArray(_vaoParticles);
-	// For each active particles system, draw it with the right parameters.
-	for(const auto & particle : _particles){
-		if(particle.note >= 0){
-			glUniform1i(globalShiftId, particle.note);
-			glUniform1f(timeId, particle.elapsed);
-			glUniform1f(durationId, particle.duration);
-			glUniform1i(channelId, particle.set);
-			glDrawElementsInstanced(GL_TRIANGLES, int(_primitiveCount), GL_UNSIGNED_INT, (void*)0, state.count);
+void MIDIScene::spawnParticles(int note, int set, float start, float duration){
+	int pid = -1;
+	if(!_particlesFree.empty()){
+		pid = _particlesFree.back();
+		_particlesFree.pop_back();
+	} else {
+		// Pool exhausted: recycle the oldest system, so that cost stays bounded and recent notes keep their particles.
+		pid = _particlesFirst;
+		releaseParticles(pid);
+		_particlesFree.pop_back();
+	}
+	Particles & particle = _particles[pid];
+	particle.note = note;
+	particle.set = set;
+	particle.start = start;
+	particle.duration = duration;
+	particle.elapsed = 0.0f;
+	// Append to the live list.
+	particle.prev = _particlesLast;
+	particle.next = -1;
+	if(_particlesLast >= 0){
+		_particles[_particlesLast].next = pid;
+	} else {
+		_particlesFirst = pid;
+	}
+	_particlesLast = pid;
+}
+
+void MIDIScene::releaseParticles(int pid){
+	Particles & particle = _particles[pid];
+	// Unlink from the live list.
+	if(particle.prev >= 0){
+		_particles[particle.prev].next = particle.next;
+	} else {
+		_particlesFirst = particle.next;
+	}
+	if(particle.next >= 0){
+		_particles[particle.next].prev = particle.prev;
+	} else {
+		_particlesLast = particle.prev;
+	}
+	particle.note = particle.set = -1;
+	particle.duration = particle.start = particle.elapsed = 0.0f;
+	particle.prev = particle.next = -1;
+	_particlesFree.push_back(pid);
+}
+
+void MIDIScene::updateParticles(double time, double speed){
+	int pid = _particlesFirst;
+	while(pid >= 0){
+		Particles & particle = _particles[pid];
+		const int next = particle.next;
+		// Give a bit of a head start to the animation.
+		particle.elapsed = (float(time) - particle.start + 0.25f) / (float(speed) * particle.duration);
+		// Disable particles that shouldn't be visible at the current time.
+		if(float(time) >= particle.start + particle.duration || float(time) < particle.start){
+			releaseParticles(pid);
 		}
+		pid = next;
+	}
+}
+
+void MIDIScene::drawParticles(const State::ParticlesState & state, bool prepass){
+
+	// Gather the live systems.
+	_particlesData.clear();
+	for(int pid = _particlesFirst; pid >= 0; pid = _particles[pid].next){
+		const Particles & particle = _particles[pid];
+		_particlesData.emplace_back(float(particle.note), float(particle.set), particle.elapsed, particle.duration);
+	}
+	if(_particlesData.empty() || state.count <= 0){
+		return;
 	}
+	// The prepass and the main pass share the same systems, only upload when they changed.
+	if(_particlesData != _particlesUploaded){
+		glBindBuffer(GL_TEXTURE_BUFFER, _particlesBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * _particlesData.size(), &_particlesData[0], GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		_particlesUploaded = _particlesData;
+	}
+
+	_programParticles.use();
+
+	// Prepass : bigger, darker particles.
+	_programParticles.uniform(_particlesColorScale, prepass ? 0.6f : 1.6f);
+	_programParticles.uniform(_particlesScale, state.scale * (prepass ? 2.0f : 1.0f));
 	
-	glBindVertexArray(0);
-	glUseProgram(0);
-	glDisable(GL_BLEND);
+	// Particles trajectories texture.
+	GLState::bindTexture(0, GL_TEXTURE_2D, _texParticles);
+	GLState::bindTexture(1, GL_TEXTURE_2D_ARRAY, state.tex);
+	GLState::bindTexture(2, GL_TEXTURE_BUFFER, _texParticlesData);
+	_programParticles.uniform(_particlesTexCount, state.texCount);
+	_programParticles.uniform(_particlesPerSystem, state.count);
+
+	// Draw the particles of all systems at once.
+	GLState::bindVertexArray(_vaoParticles);
+	const int instancesCount = state.count * int(_particlesData.size());
+	glDrawElementsInstanced(GL_TRIANGLES, int(_primitiveCount), GL_UNSIGNED_INT, (void*)0, instancesCount);
 
 }
 
-void MIDIScene::drawNotes(float time, const glm::vec2 & invScreenSize, const ColorArray & majorColors, const ColorArray & minorColors, bool reverseScroll, bool prepass){
+void MIDIScene::selectPermutations(unsigned int features){
+	_programNotes.select(features);
+	_programFlashes.select(features);
+	_programParticles.select(features);
+	_programKeys.select(features);
+	_programPedals.select(features);
+	_programWave.select(features);
+}
+
+void MIDIScene::drawNotes(bool prepass){
 	
-	glUseProgram(_programId);
+	_programNotes.use();
 	
 	// Uniforms setup.
-	GLuint screenId = glGetUniformLocation(_programId, "inverseScreenSize");
-	GLuint timeId = glGetUniformLocation(_programId, "time");
-	GLuint colorId = glGetUniformLocation(_programId, "baseColor");
-	GLuint colorMinId = glGetUniformLocation(_programId, "minorColor");
-	GLuint colorScaleId = glGetUniformLocation(_programId, "colorScale");
-	GLuint reverseId = glGetUniformLocation(_programId, "reverseMode");
-	glUniform2fv(screenId,1, &(invScreenSize[0]));
-	glUniform1f(timeId, time);
-	glUniform1f(colorScaleId, prepass ? 0.6f: 1.0f);
-
-	glUniform3fv(colorId, GLsizei(majorColors.size()), &(majorColors[0][0]));
-	glUniform3fv(colorMinId, GLsizei(minorColors.size()), &(minorColors[0][0]));
-	glUniform1i(reverseId, reverseScroll ? 1 : 0);
+	_programNotes.uniform(_notesColorScale, prepass ? 0.6f: 1.0f);
 	
 	// Draw the geometry.
-	glBindVertexArray(_vao);
+	GLState::bindVertexArray(_vao);
 	glDrawElementsInstanced(GL_TRIANGLES, int(_primitiveCount), GL_UNSIGNED_INT, (void*)0, GLsizei(_dataBufferSubsize));
-
-	glBindVertexArray(0);
-	glUseProgram(0);
 	
 }
 
-void MIDIScene::drawFlashes(float time, const glm::vec2 & invScreenSize, const ColorArray & baseColors, float userScale){
-	
-	// Need alpha blending.
-	glEnable(GL_BLEND);
-
-	glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
-	// Update the flags buffer accordingly.
+void MIDIScene::uploadActives(){
+	// Find the range of keys that changed since the last upload.
+	size_t first = 0;
+	while(first < _actives.size() && _actives[first] == _activesUploaded[first]){
+		++first;
+	}
+	if(first == _actives.size()){
+		return;
+	}
+	size_t last = _actives.size() - 1;
+	while(_actives[last] == _activesUploaded[last]){
+		--last;
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, _flagsBufferId);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, _actives.size()*sizeof(int) ,&(_actives[0]));
+	glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(int), (last - first + 1) * sizeof(int), &(_actives[first]));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	std::copy(_actives.begin() + first, _actives.begin() + last + 1, _activesUploaded.begin() + first);
+}
+
+void MIDIScene::drawFlashes(float userScale){
 	
-	glUseProgram(_programFlashesId);
+	// Update the flags buffer if needed.
+	uploadActives();
+	
+	_programFlashes.use();
 	
 	// Uniforms setup.
-	GLuint screenId1 = glGetUniformLocation(_programFlashesId, "inverseScreenSize");
-	GLuint timeId1 = glGetUniformLocation(_programFlashesId, "time");
-	GLuint colorId = glGetUniformLocation(_programFlashesId, "baseColor");
-	GLuint scaleId = glGetUniformLocation(_programFlashesId, "userScale");
-	glUniform2fv(screenId1,1, &(invScreenSize[0]));
-	glUniform1f(timeId1,time);
-	glUniform3fv(colorId, GLsizei(baseColors.size()), &(baseColors[0][0]));
-	glUniform1f(scaleId,userScale);
+	_programFlashes.uniform(_flashesUserScale, userScale);
 	// Flash texture.
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, _texFlash);
+	GLState::bindTexture(0, GL_TEXTURE_2D, _texFlash);
 	
 	// Draw the geometry.
-	glBindVertexArray(_vaoFlashes);
+	GLState::bindVertexArray(_vaoFlashes);
 	glDrawElementsInstanced(GL_TRIANGLES, int(_primitiveCount), GL_UNSIGNED_INT, (void*)0, 128);
-	
-	glBindVertexArray(0);
-	glUseProgram(0);
-	glDisable(GL_BLEND);
-
-	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
 }
 
-void MIDIScene::drawKeyboard(float, const glm::vec2 & invScreenSize, const glm::vec3 & keyColor, const ColorArray & majorColors, const ColorArray & minorColors, bool highlightKeys) {
+void MIDIScene::drawKeyboard(const glm::vec3 & keyColor) {
+
+	// Update the flags buffer if needed.
+	uploadActives();
 
-	glUseProgram(_programKeysId);
+	_programKeys.use();
 
 	// Uniforms setup.
-	const GLuint screenId1 = glGetUniformLocation(_programKeysId, "inverseScreenSize");
-	const GLuint colorId = glGetUniformLocation(_programKeysId, "keysColor");
-	const GLuint majorId = glGetUniformLocation(_programKeysId, "majorColor");
-	const GLuint minorId = glGetUniformLocation(_programKeysId, "minorColor");
-	const GLuint highId = glGetUniformLocation(_programKeysId, "highlightKeys");
-	const GLuint activesId = glGetUniformLocation(_programKeysId, "actives");
-	glUniform2fv(screenId1, 1, &(invScreenSize[0]));
-	glUniform3fv(colorId, 1, &(keyColor[0]));
-	glUniform3fv(majorId, GLsizei(majorColors.size()), &(majorColors[0][0]));
-	glUniform3fv(minorId, GLsizei(minorColors.size()), &(minorColors[0][0]));
-	glUniform1i(highId, int(highlightKeys));
-	glUniform1iv(activesId, GLsizei(_actives.size()), &(_actives[0]));
+	_programKeys.uniform(_keysColor, keyColor);
+	GLState::bindTexture(0, GL_TEXTURE_BUFFER, _texFlags);
 
 	// Draw the geometry.
-	glBindVertexArray(_vaoKeyboard);
+	GLState::bindVertexArray(_vaoKeyboard);
 	glDrawElements(GL_TRIANGLES, int(_primitiveCount), GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
-	glUseProgram(0);
 }
 
 void MIDIScene::drawPedals(float time, const glm::vec2 & invScreenSize, const State::PedalsState & state, float keyboardHeight, bool horizontalMode) {
 
-	glEnable(GL_BLEND);
-	glUseProgram(_programPedalsId);
-	glDisable(GL_CULL_FACE);
+	_programPedals.use();
 
 	// Adjust for aspect ratio.
 	const float rat = invScreenSize.y/invScreenSize.x;
@@ -437,52 +498,32 @@ void MIDIScene::drawPedals(float time, const glm::vec2 & invScreenSize, const St
 
 
 	// Uniforms setup.
-	const GLuint colorId = glGetUniformLocation(_programPedalsId, "pedalColor");
-	const GLuint opacityId = glGetUniformLocation(_programPedalsId, "pedalOpacity");
-	const GLuint flagsId = glGetUniformLocation(_programPedalsId, "pedalFlags");
-	const GLuint scaleId = glGetUniformLocation(_programPedalsId, "scale");
-	const GLuint mergeId =  glGetUniformLocation(_programPedalsId, "mergePedals");
-	const GLuint shiftId =  glGetUniformLocation(_programPedalsId, "shift");
-
-	glUniform3fv(colorId, 1, &(state.color[0]));
-	glUniform2fv(scaleId, 1, &(scale[0]));
-	glUniform2fv(shiftId, 1, &(shift[0]));
-	glUniform1f(opacityId, state.opacity);
+	_programPedals.uniform(_pedalsColor, state.color);
+	_programPedals.uniform(_pedalsScale, scale);
+	_programPedals.uniform(_pedalsShift, shift);
+	_programPedals.uniform(_pedalsOpacity, state.opacity);
 	// sostenuto, damper, soft
-	glUniform4f(flagsId, _pedals.sostenuto, _pedals.damper, _pedals.soft, _pedals.expression);
-	glUniform1i(mergeId, state.merge ? 1 : 0);
+	_programPedals.uniform(_pedalsFlags, glm::vec4(_pedals.sostenuto, _pedals.damper, _pedals.soft, _pedals.expression));
+	_programPedals.uniform(_pedalsMerge, state.merge);
 
 	// Draw the geometry.
-	glBindVertexArray(_vaoPedals);
+	GLState::bindVertexArray(_vaoPedals);
 	glDrawElements(GL_TRIANGLES, int(_countPedals), GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
-	glUseProgram(0);
-	glDisable(GL_BLEND);
-	glEnable(GL_CULL_FACE);
 }
 
-void MIDIScene::drawWaves(float time, const glm::vec2 & invScreenSize, const State::WaveState & state, float keyboardHeight) {
+void MIDIScene::drawWaves(float time, const State::WaveState & state) {
 
-	glEnable(GL_BLEND);
-	glUseProgram(_programWaveId);
-	glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+	_programWave.use();
 
 	// Uniforms setup.
-	const GLuint colorId = glGetUniformLocation(_programWaveId, "waveColor");
-	const GLuint opacityId = glGetUniformLocation(_programWaveId, "waveOpacity");
-	const GLuint spreadId = glGetUniformLocation(_programWaveId, "spread");
-	const GLuint scaleId = glGetUniformLocation(_programWaveId, "amplitude");
-	const GLuint freqId =  glGetUniformLocation(_programWaveId, "freq");
-	const GLuint phaseId =  glGetUniformLocation(_programWaveId, "phase");
-	const GLuint shiftId =  glGetUniformLocation(_programWaveId, "keyboardSize");
-
-	glUniform3fv(colorId, 1, &(state.color[0]));
-	glUniform1f(shiftId, keyboardHeight);
-	glUniform1f(opacityId, state.opacity);
-	glUniform1f(spreadId, state.spread);
+	_programWave.uniform(_waveColor, state.color);
+	_programWave.uniform(_waveOpacity, state.opacity);
+	_programWave.uniform(_waveSpread, state.spread);
+	const GLint scaleId = _programWave.location(_waveAmplitude);
+	const GLint freqId = _programWave.location(_waveFrequency);
+	const GLint phaseId = _programWave.location(_wavePhase);
 
-	glBindVertexArray(_vaoWave);
+	GLState::bindVertexArray(_vaoWave);
 
 	// Fixed initial parameters.
 	const float ampls[4] = {-0.023f, -0.011f, 0.017f, 0.009f};
@@ -498,52 +539,21 @@ void MIDIScene::drawWaves(float time, const glm::vec2 & invScreenSize, const Sta
 		glUniform1f(phaseId, phase);
 		glDrawElements(GL_TRIANGLES, int(_countWave), GL_UNSIGNED_INT, (void*)0);
 	}
-
-	glBindVertexArray(0);
-	glUseProgram(0);
-	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
-	glDisable(GL_BLEND);
-}
-
-void MIDIScene::setMinMaxKeys(int minKey, int minKeyMajor, int notesCount){
-	glUseProgram(_programId);
-	glUniform1i(glGetUniformLocation(_programId, "minNoteMajor"), minKeyMajor);
-	glUniform1f(glGetUniformLocation(_programId, "notesCount"), float(notesCount));
-	glUseProgram(_programFlashesId);
-	glUniform1i(glGetUniformLocation(_programFlashesId, "minNote"), minKey);
-	glUniform1f(glGetUniformLocation(_programFlashesId, "notesCount"), float(notesCount));
-	glUseProgram(_programKeysId);
-	glUniform1i(glGetUniformLocation(_programKeysId, "minNoteMajor"), minKeyMajor);
-	glUniform1f(glGetUniformLocation(_programKeysId, "notesCount"), float(notesCount));
-	glUseProgram(_programParticulesId);
-	glUniform1i(glGetUniformLocation(_programParticulesId, "minNote"), minKey);
-	glUniform1f(glGetUniformLocation(_programParticulesId, "notesCount"), float(notesCount));
-	glUseProgram(0);
-}
-
-
-void MIDIScene::setOrientation(bool horizontal){
-	const int val = horizontal ? 1 : 0;
-	glUseProgram(_programId);
-	glUniform1i(glGetUniformLocation(_programId, "horizontalMode"), val);
-	glUseProgram(_programFlashesId);
-	glUniform1i(glGetUniformLocation(_programFlashesId, "horizontalMode"), val);
-	glUseProgram(_programKeysId);
-	glUniform1i(glGetUniformLocation(_programKeysId, "horizontalMode"), val);
-	glUseProgram(_programParticulesId);
-	glUniform1i(glGetUniformLocation(_programParticulesId, "horizontalMode"), val);
-	glUseProgram(_programWaveId);
-	glUniform1i(glGetUniformLocation(_programWaveId, "horizontalMode"), val);
-	glUseProgram(0);
 }
 
 void MIDIScene::clean(){
 	glDeleteVertexArrays(1, &_vao);
 	glDeleteVertexArrays(1, &_vaoFlashes);
+	glDeleteTextures(1, &_texFlags);
 	glDeleteVertexArrays(1, &_vaoParticles);
-	glDeleteProgram(_programId);
-	glDeleteProgram(_programFlashesId);
-	glDeleteProgram(_programParticulesId);
+	glDeleteBuffers(1, &_particlesBuffer);
+	glDeleteTextures(1, &_texParticlesData);
+	_programNotes.clean();
+	_programFlashes.clean();
+	_programParticles.clean();
+	_programKeys.clean();
+	_programPedals.clean();
+	_programWave.clean();
 }
 
 void MIDIScene::upload(const std::vector<GPUNote> & data){
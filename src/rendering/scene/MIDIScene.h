@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include "../midi/MIDIFile.h"
 #include "../State.h"
+#include "../ShaderProgram.h"
 
 #include <fstream>
 
@@ -13,33 +14,38 @@ public:
 
 	MIDIScene();
 
+	/// Switch the programs to the shader permutations for the given features (see ShaderProgram::Feature).
+	void selectPermutations(unsigned int features);
+
 	/// Draw function
-	void drawNotes(float time, const glm::vec2 & invScreenSize, const ColorArray & majorColors, const ColorArray & minorColors, bool reverseScroll, bool prepass);
+	/// Layout, colors and timing are read from the shared uniform blocks.
+	void drawNotes(bool prepass);
 	
-	void drawFlashes(float time, const glm::vec2 & invScreenSize, const ColorArray & baseColors, float userScale);
+	void drawFlashes(float userScale);
 	
-	void drawParticles(float time, const glm::vec2 & invScreenSize, const State::ParticlesState & state, bool prepass);
+	void drawParticles(const State::ParticlesState & state, bool prepass);
 	
-	void drawKeyboard(float time, const glm::vec2 & invScreenSize, const glm::vec3 & keyColor, const ColorArray & majorColors, const ColorArray & minorColors, bool highlightKeys);
+	void drawKeyboard(const glm::vec3 & keyColor);
 
 	void drawPedals(float time, const glm::vec2 & invScreenSize, const State::PedalsState & state, float keyboardHeight, bool horizontalMode);
 
-	void drawWaves(float time, const glm::vec2 & invScreenSize, const State::WaveState & state, float keyboardHeight);
+	void drawWaves(float time, const State::WaveState & state);
 
 	/// Clean function
 	void clean();
 	
-	void setScaleAndMinorWidth(const float scale, const float minorWidth);
-
 	void setParticlesParameters(const float speed, const float expansion);
 
-	void setKeyboardSizeAndFadeout(float keyboardHeight, float fadeOut);
+	void resetParticles();
 
-	void setMinMaxKeys(int minKey, int minKeyMajor, int notesCount);
+	/// Set the maximum number of simultaneous particle systems, live systems are discarded.
+	void setParticlesPoolSize(int size);
 
-	void setOrientation(bool horizontal);
+	/// Reset the particles, the next update will start systems for the notes after the given time.
+	virtual void restartAt(double time);
 
-	void resetParticles();
+	/// Longest lifetime of a particle system, systems started earlier than that before a time have ended.
+	virtual double particlesLifetime() const;
 
 	// Type specific methods.
 
@@ -74,6 +80,8 @@ protected:
 		float duration = 0.0f;
 		float start = 1000000.0f;
 		float elapsed = 0.0f;
+		int prev = -1; ///< Previous live system, in spawn order.
+		int next = -1; ///< Next live system, in spawn order.
 	};
 
 	struct GPUNote {
@@ -88,8 +96,17 @@ protected:
 	
 	void upload(const std::vector<GPUNote> & data, int mini, int maxi);
 
+	/// Start a particle system for a note, recycling the oldest one if the pool is full.
+	void spawnParticles(int note, int set, float start, float duration);
+
+	/// Update the live particle systems lifetimes and release the finished ones.
+	void updateParticles(double time, double speed);
+
 	std::array<int, 128> _actives;
 	std::vector<Particles> _particles;
+	std::vector<int> _particlesFree; ///< Available systems, used as a stack.
+	int _particlesFirst = -1; ///< Oldest live system.
+	int _particlesLast = -1; ///< Newest live system.
 	Pedals _pedals;
 	int _dataBufferSubsize = 0;
 	
@@ -97,23 +114,54 @@ private:
 
 	void renderSetup();
 
-	GLuint _programId;
-	GLuint _programFlashesId;
-	GLuint _programParticulesId;
-	GLuint _programKeysId;
-	GLuint _programPedalsId;
-	GLuint _programWaveId;
+	void releaseParticles(int pid);
+
+	/// Upload the range of active keys that changed since the last upload, if any.
+	void uploadActives();
+
+	ShaderProgram _programNotes;
+	ShaderProgram _programFlashes;
+	ShaderProgram _programParticles;
+	ShaderProgram _programKeys;
+	ShaderProgram _programPedals;
+	ShaderProgram _programWave;
+	// Uniforms updated at each frame.
+	ShaderProgram::Uniform _notesColorScale;
+	ShaderProgram::Uniform _flashesUserScale;
+	ShaderProgram::Uniform _particlesColorScale;
+	ShaderProgram::Uniform _particlesScale;
+	ShaderProgram::Uniform _particlesTexCount;
+	ShaderProgram::Uniform _particlesPerSystem;
+	ShaderProgram::Uniform _keysColor;
+	ShaderProgram::Uniform _pedalsColor;
+	ShaderProgram::Uniform _pedalsScale;
+	ShaderProgram::Uniform _pedalsShift;
+	ShaderProgram::Uniform _pedalsOpacity;
+	ShaderProgram::Uniform _pedalsFlags;
+	ShaderProgram::Uniform _pedalsMerge;
+	ShaderProgram::Uniform _waveColor;
+	ShaderProgram::Uniform _waveOpacity;
+	ShaderProgram::Uniform _waveSpread;
+	ShaderProgram::Uniform _waveAmplitude;
+	ShaderProgram::Uniform _waveFrequency;
+	ShaderProgram::Uniform _wavePhase;
 	
 	GLuint _vao;
 	GLuint _ebo;
 	GLuint _dataBuffer;
 	
 	GLuint _flagsBufferId;
+	GLuint _texFlags; ///< Buffer texture view of the flags, for the keyboard.
+	std::array<int, 128> _activesUploaded; ///< Flags currently on the GPU.
 	GLuint _vaoFlashes;
 	GLuint _texFlash;
 	
 	GLuint _vaoParticles;
 	GLuint _texParticles;
+	GLuint _particlesBuffer;
+	GLuint _texParticlesData;
+	std::vector<glm::vec4> _particlesData;
+	std::vector<glm::vec4> _particlesUploaded;
 
 	GLuint _vaoKeyboard;
 
@@ -7,6 +7,7 @@
 
 #include "../../helpers/ProgramUtilities.h"
 #include "../../helpers/ResourcesManager.h"
+#include "../../helpers/Trace.h"
 
 #include "MIDISceneFile.h"
 
@@ -15,6 +16,12 @@
 #undef MAX
 #endif
 
+/// Lifetime of the particles system of a note.
+static float particlesDuration(float noteDuration){
+	//const float durationTweak = 3.0f - note.velocity / 127.0f * 2.5f;
+	return (std::max)(noteDuration * 2.0f, noteDuration + 1.2f);
+}
+
 MIDISceneFile::~MIDISceneFile(){}
 
 MIDISceneFile::MIDISceneFile(const std::string & midiFilePath, const SetOptions & options) : MIDIScene() {
@@ -31,6 +38,7 @@ MIDISceneFile::MIDISceneFile(const std::string & midiFilePath, const SetOptions
 
 
 void MIDISceneFile::updateSets(const SetOptions & options){
+	TRACE_SCOPE("Upload notes");
 	// Generate note data for rendering.
 	_midiFile.updateSets(options);
 
@@ -60,20 +68,16 @@ void MIDISceneFile::updateSets(const SetOptions & options){
 	// Upload to the GPU.
 	upload(data);
 	_dataBufferSubsize = int(data.size());
+
+	_particlesLifetime = 0.0;
+	for(const GPUNote & note : data){
+		_particlesLifetime = (std::max)(_particlesLifetime, double(particlesDuration(note.duration)));
+	}
 }
 
 void MIDISceneFile::updatesActiveNotes(double time, double speed){
 	// Update the particle systems lifetimes.
-	for(auto & particle : _particles){
-		// Give a bit of a head start to the animation.
-		particle.elapsed = (float(time) - particle.start + 0.25f) / (float(speed) * particle.duration);
-		// Disable particles that shouldn't be visible at the current time.
-		if(float(time) >= particle.start + particle.duration || float(time) < particle.start){
-			particle.note = -1;
-			particle.set = -1;
-			particle.duration = particle.start = particle.elapsed = 0.0f;
-		}
-	}
+	updateParticles(time, speed);
 	// Get notes actives.
 	auto actives = ActiveNotesArray();
 	_midiFile.getNotesActive(actives, time, 0);
@@ -82,19 +86,8 @@ void MIDISceneFile::updatesActiveNotes(double time, double speed){
 		_actives[i] = note.enabled ? note.set : -1;
 		// Check if the note was triggered at this frame.
 		if(note.start > _previousTime && note.start <= time){
-			// Find an available particles system and update it with the note parameters.
-			for(auto & particle : _particles){
-				if(particle.note < 0){
-					// Update with new note parameter.
-					//const float durationTweak = 3.0f - note.velocity / 127.0f * 2.5f;
-					particle.duration = (std::max)(note.duration*2.0f, note.duration + 1.2f);
-					particle.start = note.start;
-					particle.note = i;
-					particle.set = note.set;
-					particle.elapsed = 0.0f;
-					break;
-				}
-			}
+			// Start a particles system with the note parameters.
+			spawnParticles(i, note.set, note.start, particlesDuration(note.duration));
 		}
 	}
 	_previousTime = time;
@@ -104,6 +97,15 @@ void MIDISceneFile::updatesActiveNotes(double time, double speed){
 	_midiFile.getPedalsActive(_pedals.damper, _pedals.sostenuto, _pedals.soft, _pedals.expression, time, 0);
 }
 
+void MIDISceneFile::restartAt(double time){
+	resetParticles();
+	_previousTime = time;
+}
+
+double MIDISceneFile::particlesLifetime() const {
+	return _particlesLifetime;
+}
+
 double MIDISceneFile::duration() const {
 	return _midiFile.duration();
 }
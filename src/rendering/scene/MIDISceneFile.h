@@ -18,6 +18,10 @@ public:
 
 	void updatesActiveNotes(double time, double speed);
 
+	void restartAt(double time);
+
+	double particlesLifetime() const;
+
 	double duration() const;
 
 	double secondsPerMeasure() const;
@@ -35,6 +39,7 @@ private:
 	MIDIFile _midiFile;
 	std::string _midiFilePath;
 	double _previousTime = 0.0;
+	double _particlesLifetime = 0.0;
 	
 };
 
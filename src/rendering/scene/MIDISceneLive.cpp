@@ -80,16 +80,7 @@ void MIDISceneLive::updatesActiveNotes(double time, double speed){
 	}
 
 	// Update the particle systems lifetimes.
-	for(auto & particle : _particles){
-		// Give a bit of a head start to the animation.
-		particle.elapsed = (float(time) - particle.start + 0.25f) / (float(speed) * particle.duration);
-		// Disable particles that shouldn't be visible at the current time.
-		if(float(time) >= particle.start + particle.duration || float(time) < particle.start){
-			particle.note = -1;
-			particle.set = -1;
-			particle.duration = particle.start = particle.elapsed = 0.0f;
-		}
-	}
+	updateParticles(time, speed);
 
 	// Restore all active flags.
 	for(size_t nid = 0; nid < _actives.size(); ++nid){
@@ -180,19 +171,9 @@ void MIDISceneLive::updatesActiveNotes(double time, double speed){
 				minUpdated = (std::min)(minUpdated, int(index));
 				maxUpdated = (std::max)(maxUpdated, int(index));
 
-				// Find an available particles system and update it with the note parameters.
-				for(auto & particle : _particles){
-					if(particle.note < 0){
-						// Update with new note parameter.
-						//const float durationTweak = 3.0f - float(velocity) / 127.0f * 2.5f;
-						particle.duration = 10.0f; // Fixed value.
-						particle.start = newNote.start;
-						particle.note = note;
-						particle.set = int(newNote.set);
-						particle.elapsed = 0.0f;
-						break;
-					}
-				}
+				// Start a particles system with the note parameters.
+				//const float durationTweak = 3.0f - float(velocity) / 127.0f * 2.5f;
+				spawnParticles(note, int(newNote.set), newNote.start, 10.0f); // Fixed duration.
 
 				++_notesCount;
 			}
@@ -279,18 +260,8 @@ void MIDISceneLive::updatesActiveNotes(double time, double speed){
 		}
 		// Detect notes that started at this frame.
 		if(note.start > _previousTime && note.start <= time){
-			// Find an available particles system and update it with the note parameters.
-			for(auto & particle : _particles){
-				if(particle.note < 0){
-					// Update with new note parameter.
-					particle.duration = (std::max)(note.duration*2.0f, note.duration + 1.2f);
-					particle.start = note.start;
-					particle.note = noteId.note;
-					particle.set = int(note.set);
-					particle.elapsed = 0.0f;
-					break;
-				}
-			}
+			// Start a particles system with the note parameters.
+			spawnParticles(noteId.note, int(note.set), note.start, (std::max)(note.duration*2.0f, note.duration + 1.2f));
 		}
 	}
 